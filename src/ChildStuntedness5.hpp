@@ -25,11 +25,23 @@
 #define CHILDSTUNTEDNESS5_HPP_
 
 #include "array2d.hpp"
-#include "extract_subject_ranges.hpp"
+#include "blob.hpp"
+#include "cohort.hpp"
+#include "density.hpp"
+#include "encoder.hpp"
+#include "fm.hpp"
+#include "gram.hpp"
+#include "interaction.hpp"
 #include "linreg.hpp"
+#include "pivot.hpp"
+#include "regpath.hpp"
+#include "select.hpp"
+#include "task_graph.hpp"
+#include "thread_pool.hpp"
 
 #include <random>
 #include <iterator>
+#include <algorithm>
 #include <valarray>
 #include <vector>
 #include <string>
@@ -37,6 +49,16 @@
 #include <cstring>
 #include <map>
 #include <ctime>
+#include <numeric>
+#include <memory>
+#include <chrono>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
 
 enum ScenarioType
 {
@@ -45,8 +67,36 @@ enum ScenarioType
     S3
 };
 
+enum class DesignOutput
+{
+    // remapped base columns and their pairwise products
+    Raw,
+    // the same, also passed through standardize_X_data
+    Standardized,
+    // remapped base columns only, products left to num::InteractionDesign
+    Implicit
+};
+
+enum class Model
+{
+    // ridge regression on the design with its product columns
+    Linear,
+    // factorization machine on the base columns, see num::FactorizationMachine
+    FM
+};
+
+enum class TargetEncoding
+{
+    // mean target per distinct value, over all training rows
+    Exact,
+    // smoothed mean per histogram bin, out-of-fold for training rows
+    Binned
+};
+
 typedef long double real_type;
 
+typedef std::map<num::size_type, num::TargetEncoder<real_type>> encoders_type;
+
 template<typename _ValueType>
 std::valarray<std::pair<_ValueType, _ValueType>> pairwise_perm(num::size_type max)
 {
@@ -71,40 +121,23 @@ std::valarray<std::pair<_ValueType, _ValueType>> pairwise_perm(num::size_type ma
     return result;
 }
 
-num::array2d<real_type>
-preprocess_features(
+/*
+ * Pairs of (remapped) feature columns whose products get appended
+ * to the design by preprocess_features, for a design of N columns
+ */
+std::valarray<std::pair<num::size_type, num::size_type>>
+feature_pairs(
     const enum ScenarioType scenario,
-    num::array2d<real_type> && in_features
+    const num::size_type N
 )
 {
     if (scenario == ScenarioType::S1)
     {
-        const num::size_type M{in_features.shape().first};
-        const num::size_type N{in_features.shape().second};
-
-        const auto pairwise = pairwise_perm<num::size_type>(N);
-
-        num::array2d<real_type> result =
-            num::zeros<real_type>({M, N + pairwise.size()});
-
-        result[result.columns(0, N - 1)] = in_features[in_features.columns(0, N - 1)];
-
-        num::size_type extra_col{N};
-        for (auto pair : pairwise)
-        {
-            result[result.column(extra_col)] =
-                (std::valarray<real_type>)in_features[in_features.column(pair.first)] * (std::valarray<real_type>)in_features[in_features.column(pair.second)];
-            ++extra_col;
-        }
-        assert(extra_col == result.shape().second);
-        in_features = result;
+        return pairwise_perm<num::size_type>(N);
     }
     else if (scenario == ScenarioType::S2)
     {
-        const num::size_type M{in_features.shape().first};
-        const num::size_type N{in_features.shape().second};
-
-        const std::valarray<std::pair<num::size_type, num::size_type>> pairwise =
+        return
         { // max = 80519.7
             {10, 10},
             {12, 12},
@@ -140,23 +173,6 @@ preprocess_features(
             {28, 29} // 89077
             // #30
         };
-
-        num::array2d<real_type> result =
-            num::zeros<real_type>({M, N + pairwise.size()});
-
-        result[result.columns(0, N - 1)] = in_features[in_features.columns(0, N - 1)];
-
-//        const auto pairwise = pairwise_perm<real_type>(N);
-
-        num::size_type extra_col{N};
-        for (auto pair : pairwise)
-        {
-            result[result.column(extra_col)] =
-                (std::valarray<real_type>)in_features[in_features.column(pair.first)] * (std::valarray<real_type>)in_features[in_features.column(pair.second)];
-            ++extra_col;
-        }
-        assert(extra_col == result.shape().second);
-        in_features = result;
 //        enum col
 //        {
 //            wtkg_1,
@@ -191,12 +207,9 @@ preprocess_features(
 //            bmi_5,
 //        };
     }
-    else if (scenario == ScenarioType::S3)
+    else
     {
-        const num::size_type M{in_features.shape().first};
-        const num::size_type N{in_features.shape().second};
-
-        const std::valarray<std::pair<num::size_type, num::size_type>> pairwise =
+        return
         { // max = 338943
             {19, 19},
             {19, 20},
@@ -242,82 +255,195 @@ preprocess_features(
             {16,22},
             {5,7},
         };
+    }
+}
+
+/*
+ * Pairs in the text form read_feature_pairs accepts: one pair per line,
+ * the scenario (S1, S2 or S3) followed by the two column indices
+ */
+void
+write_feature_pairs(
+    std::ostream & os,
+    const enum ScenarioType scenario,
+    const std::valarray<std::pair<num::size_type, num::size_type>> & pairs
+)
+{
+    for (const auto & pair : pairs)
+    {
+        os << 'S' << scenario + 1 << ' ' << pair.first << ' ' << pair.second << '\n';
+    }
+}
 
-        num::array2d<real_type> result =
-            num::zeros<real_type>({M, N + pairwise.size()});
+/*
+ * Per scenario lists of pairs, as write_feature_pairs puts them;
+ * empty lines and those starting with '#' are skipped, any other line
+ * not of that form throws std::invalid_argument. Column indices are
+ * checked against the design by check_feature_pairs.
+ */
+std::map<int, std::valarray<std::pair<num::size_type, num::size_type>>>
+read_feature_pairs(std::istream & is)
+{
+    std::map<int, std::vector<std::pair<num::size_type, num::size_type>>> pairs;
+
+    std::string line;
+    while (std::getline(is, line))
+    {
+        if (line.empty() || line[0] == '#')
+        {
+            continue;
+        }
 
-        result[result.columns(0, N - 1)] = in_features[in_features.columns(0, N - 1)];
+        std::istringstream iss(line);
+        char tag;
+        int scenario;
+        std::pair<num::size_type, num::size_type> pair;
 
-//        const auto pairwise = pairwise_perm<real_type>(N);
+        std::string rest;
 
-        num::size_type extra_col{N};
-        for (auto pair : pairwise)
+        iss >> tag >> scenario >> pair.first >> pair.second;
+        if (!iss || tag != 'S' || scenario < 1 || scenario > 3 || (iss >> rest))
         {
-            result[result.column(extra_col)] =
-                (std::valarray<real_type>)in_features[in_features.column(pair.first)] * (std::valarray<real_type>)in_features[in_features.column(pair.second)];
-            ++extra_col;
+            throw std::invalid_argument("malformed feature pair line: \"" + line + "\"");
         }
-        assert(extra_col == result.shape().second);
-        in_features = result;
-//        const num::size_type M{in_features.shape().first};
-//        const num::size_type N{in_features.shape().second};
-//
-//        const auto pairwise = pairwise_perm<real_type>(N);
-//
-//        num::array2d<real_type> result =
-//            num::zeros<real_type>({M, N + pairwise.size()});
-//
-//        result[result.columns(0, N - 1)] = in_features[in_features.columns(0, N - 1)];
-//
-//        num::size_type extra_col{N};
-//        for (auto pair : pairwise)
-//        {
-//            result[result.column(extra_col)] =
-//                (std::valarray<real_type>)in_features[in_features.column(pair.first)] * (std::valarray<real_type>)in_features[in_features.column(pair.second)];
-//            ++extra_col;
-//        }
-//        assert(extra_col == result.shape().second);
-//        in_features = result;
+
+        pairs[scenario - 1].push_back(pair);
+    }
+
+    std::map<int, std::valarray<std::pair<num::size_type, num::size_type>>> result;
+    for (const auto & item : pairs)
+    {
+        result[item.first] = std::valarray<std::pair<num::size_type, num::size_type>>(
+            item.second.data(), item.second.size());
+    }
+
+    return result;
+}
+
+/*
+ * Throws std::out_of_range unless both columns of every pair are
+ * among the N of the design. Squares, (c, c), are valid pairs.
+ */
+void
+check_feature_pairs(
+    const std::valarray<std::pair<num::size_type, num::size_type>> & pairs,
+    const num::size_type N
+)
+{
+    for (const auto & pair : pairs)
+    {
+        if (pair.first >= N || pair.second >= N)
+        {
+            throw std::out_of_range("feature pair (" + std::to_string(pair.first) + ", " +
+                std::to_string(pair.second) + ") outside of the " + std::to_string(N) + " design columns");
+        }
+    }
+}
+
+num::array2d<real_type>
+preprocess_features(
+    const enum ScenarioType scenario,
+    num::array2d<real_type> && in_features
+)
+{
+    const num::size_type M{in_features.shape().first};
+    const num::size_type N{in_features.shape().second};
+
+    const auto pairwise = feature_pairs(scenario, N);
+
+    num::array2d<real_type> result =
+        num::zeros<real_type>({M, N + pairwise.size()});
+
+    result[result.columns(0, N - 1)] = in_features[in_features.columns(0, N - 1)];
+
+    num::size_type extra_col{N};
+    for (auto pair : pairwise)
+    {
+        result[result.column(extra_col)] =
+            (std::valarray<real_type>)in_features[in_features.column(pair.first)] * (std::valarray<real_type>)in_features[in_features.column(pair.second)];
+        ++extra_col;
     }
+    assert(extra_col == result.shape().second);
 
-    return in_features;
+    return result;
 }
 
-std::map<real_type, real_type>
+/*
+ * Mean target for every distinct value of feat, as a lookup table
+ */
+num::DensityTable<real_type>
 map_feature_y_density(
     const std::valarray<real_type> & feat,
     const std::valarray<real_type> & y
 )
 {
-    std::map<real_type, std::pair<num::size_type, num::size_type>> event_count;
-
     assert(feat.size() == y.size());
 
-    for (num::size_type r{0}; r < feat.size(); ++r)
-    {
-        event_count[feat[r]].first++;
-        event_count[feat[r]].second += y[r];
-    }
+    std::vector<num::size_type> order(feat.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(),
+        [&feat](const num::size_type lhs, const num::size_type rhs)
+        {
+            return feat[lhs] < feat[rhs];
+        }
+    );
 
-    std::map<real_type, real_type> result;
+    std::vector<real_type> keys;
+    std::vector<real_type> densities;
 
-    for (auto count : event_count)
+    for (num::size_type first{0}; first < order.size(); /* nop */)
     {
-        result[count.first] = (real_type)count.second.second / count.second.first;
+        const real_type key = feat[order[first]];
+
+        // target sum is accumulated in an integer, as it always was
+        num::size_type count{0};
+        num::size_type sum{0};
+
+        for (; first < order.size() && feat[order[first]] == key; ++first)
+        {
+            ++count;
+            sum += y[order[first]];
+        }
+
+        keys.push_back(key);
+        densities.push_back((real_type)sum / count);
     }
 
-    return result;
+    return num::DensityTable<real_type>(std::move(keys), std::move(densities));
 }
 
-std::valarray<real_type> do_lin_reg(
-    const real_type C,
+/*
+ * Scale column c of the training and testing data by the training deviation
+ */
+void
+standardize_column(
+    num::array2d<real_type> & X_train,
+    num::array2d<real_type> & X_test,
+    const num::size_type c
+)
+{
+    typedef std::valarray<real_type> vector_type;
+
+    const vector_type & col = X_train[X_train.column(c)];
+    const vector_type & colt = X_test[X_test.column(c)];
+
+    const real_type mu = num::mean<real_type>(col);
+    const real_type dev = num::std<real_type>(col);
+
+    X_train[X_train.column(c)] = col - mu;
+    X_train[X_train.column(c)] = col / dev;
+
+    X_test[X_test.column(c)] = colt - mu;
+    X_test[X_test.column(c)] = colt / dev;
+}
+
+std::pair<num::array2d<real_type>, num::array2d<real_type>>
+standardize_X_data(
     const num::array2d<real_type> & i_X_train,
-    const std::valarray<real_type> & i_y_train,
     const num::array2d<real_type> & i_X_test
 )
 {
     typedef num::array2d<real_type> array_type;
-    typedef std::valarray<real_type> vector_type;
 
     // I'll be adding the intercept column
     const num::size_type NUM_FEAT{i_X_train.shape().second + 1};
@@ -336,31 +462,41 @@ std::valarray<real_type> do_lin_reg(
     // X_test[:, 1:] = i_X_test[:, :]
     X_test[X_test.columns(1, -1)] = i_X_test[i_X_test.columns(0, -1)];
 
-    vector_type y_train = i_y_train;
-    vector_type theta(0.0, X_train.shape().second);
-
     // standardization
     for (num::size_type c{1}; c < X_train.shape().second; ++c)
     {
-        const vector_type & col = X_train[X_train.column(c)];
-        const vector_type & colt = X_test[X_test.column(c)];
+        standardize_column(X_train, X_test, c);
+    }
 
-        const real_type mu = num::mean<real_type>(col);
-        const real_type dev = num::std<real_type>(col);
+    return std::make_pair(X_train, X_test);
+}
 
-        X_train[X_train.column(c)] = col - mu;
-        X_train[X_train.column(c)] = col / dev;
+/*
+ * do_lin_reg on design matrices standardize_X_data has already been applied to,
+ * or on their num::InteractionDesign equivalents
+ */
+template<typename _DesignType>
+std::valarray<real_type> do_lin_reg_std(
+    const real_type C,
+    const _DesignType & X_train,
+    const std::valarray<real_type> & i_y_train,
+    const _DesignType & X_test,
+    const num::Solver solver = num::Solver::FMinCG
+)
+{
+    typedef std::valarray<real_type> vector_type;
+    typedef num::LinearRegression<real_type, _DesignType> regressor_type;
 
-        X_test[X_test.column(c)] = colt - mu;
-        X_test[X_test.column(c)] = colt / dev;
-    }
+    vector_type y_train = i_y_train;
+    vector_type theta(0.0, X_train.shape().second);
 
-    num::LinearRegression<real_type> linRegClassifier(
-        num::LinearRegression<real_type>::array_type{X_train},
-        num::LinearRegression<real_type>::vector_type{y_train},
-        num::LinearRegression<real_type>::vector_type{theta},
+    regressor_type linRegClassifier(
+        typename regressor_type::design_type{X_train},
+        typename regressor_type::vector_type{y_train},
+        typename regressor_type::vector_type{theta},
         C,
-        150
+        150,
+        solver
     );
 
     auto fit_theta = linRegClassifier.fit();
@@ -377,23 +513,132 @@ std::valarray<real_type> do_lin_reg(
     return pred;
 }
 
-std::pair<num::array2d<real_type>, num::array2d<real_type>>
-remap_X_data(
-    const enum ScenarioType scenario,
+/*
+ * Coefficients of the regression of do_lin_reg_std, intercept first
+ */
+template<typename _DesignType>
+std::valarray<real_type> fit_lin_reg_std(
+    const real_type C,
+    const _DesignType & X_train,
+    const std::valarray<real_type> & y_train,
+    const num::Solver solver = num::Solver::FMinCG
+)
+{
+    typedef num::LinearRegression<real_type, _DesignType> regressor_type;
+
+    const regressor_type linRegClassifier(
+        typename regressor_type::design_type{X_train},
+        typename regressor_type::vector_type{y_train},
+        typename regressor_type::vector_type(0.0, X_train.shape().second),
+        C,
+        150,
+        solver
+    );
+
+    return linRegClassifier.fit();
+}
+
+/*
+ * do_lin_reg_std counterpart for num::FactorizationMachine, X_train and
+ * X_test are standardized base designs without any product columns
+ */
+std::valarray<real_type> do_fm_std(
+    const real_type C,
+    const num::size_type rank,
+    const num::array2d<real_type> & X_train,
+    const std::valarray<real_type> & y_train,
+    const num::array2d<real_type> & X_test,
+    const unsigned int seed
+)
+{
+    typedef num::FactorizationMachine<real_type> regressor_type;
+
+    const regressor_type fm(
+        regressor_type::array_type{X_train},
+        regressor_type::vector_type{y_train},
+        C,
+        rank,
+        150,
+        seed
+    );
+
+    return fm.predict(X_test, fm.fit());
+}
+
+std::valarray<real_type> do_lin_reg(
+    const real_type C,
     const num::array2d<real_type> & i_X_train,
+    const std::valarray<real_type> & i_y_train,
     const num::array2d<real_type> & i_X_test,
-    const std::valarray<real_type> & i_y_train
+    const num::Solver solver = num::Solver::FMinCG
 )
 {
-    assert(i_X_train.shape().second == i_X_test.shape().second);
+    auto X_train_test = standardize_X_data(i_X_train, i_X_test);
 
-    typedef std::valarray<real_type> vector_type;
+    return do_lin_reg_std(C, X_train_test.first, i_y_train, X_train_test.second, solver);
+}
+
+/*
+ * Same regression as do_lin_reg, solved directly from the normal equations.
+ *
+ * The Gram matrix is built on the unscaled, intercept-augmented design
+ * and kept in gram, so that across imputation repetitions only the cells
+ * given as changed (see num::GramCache::update) are paid for. Scaling of
+ * standardize_X_data is then applied to the Gram matrix rather than to
+ * the design.
+ */
+std::valarray<real_type> do_lin_reg_gram(
+    const real_type C,
+    num::GramCache<real_type> & gram,
+    const num::array2d<real_type> & i_X_train,
+    const std::valarray<real_type> & i_y_train,
+    const num::array2d<real_type> & i_X_test,
+    const std::vector<num::size_type> & changed_cells,
+    const std::vector<num::size_type> & changed_offsets
+)
+{
     typedef num::array2d<real_type> array_type;
+    typedef std::valarray<real_type> vector_type;
 
-    array_type X_train = i_X_train;
-    array_type X_test = i_X_test;
+    const num::size_type M{i_X_train.shape().first};
+    const num::size_type NUM_FEAT{i_X_train.shape().second + 1};
+
+    gram.update(i_X_train, i_y_train, changed_cells, changed_offsets);
+
+    // column deviations, as num::std would compute them, from sums in G
+    vector_type dev(1.0, NUM_FEAT);
+    for (num::size_type c{1}; c < NUM_FEAT; ++c)
+    {
+        const real_type mu = gram.gram().at(0, c) / M;
+
+        dev[c] = std::sqrt((gram.gram().at(c, c) - M * mu * mu) / (M - 1));
+    }
+
+    array_type G = gram.gram();
+    for (num::size_type r{0}; r < NUM_FEAT; ++r)
+    {
+        G[G.row(r)] = vector_type(G[G.row(r)]) / (dev * dev[r]);
+    }
 
-    std::initializer_list<int> col_selector;
+    const vector_type theta = num::ridge_normal_solve(std::move(G), vector_type(gram.Xty() / dev), C);
+
+    // fold the scaling into theta instead of rescaling the test design
+    const vector_type raw_theta = theta / dev;
+
+    vector_type pred(raw_theta[0], i_X_test.shape().first);
+    i_X_test.mul(array_type::Axis::Row, vector_type(raw_theta[std::slice(1, NUM_FEAT - 1, 1)]), pred,
+        std::plus<real_type>());
+
+    return pred;
+}
+
+/*
+ * Columns which remap_X_data replaces with their target density
+ */
+std::vector<num::size_type>
+remap_columns(const enum ScenarioType scenario)
+{
+    std::vector<num::size_type> col_selector;
     if (scenario == ScenarioType::S3)
     {
         col_selector =
@@ -429,217 +674,383 @@ remap_X_data(
         };
     }
 
-    for (auto COLUMN : col_selector)
-    {
-        auto event_density = map_feature_y_density(X_train[X_train.column(COLUMN)], i_y_train);
-        std::cerr << "feature density size: " << event_density.size() << std::endl;
+    return col_selector;
+}
 
-        vector_type mapped_train_col = X_train[X_train.column(COLUMN)];
-        std::transform(std::begin(mapped_train_col), std::end(mapped_train_col), std::begin(mapped_train_col),
-            [&event_density](const real_type & x) -> real_type
-            {
-                if (event_density.find(x) != event_density.cend())
-                {
-                    return event_density[x];
-                }
-                else if (event_density.upper_bound(x) != event_density.cend())
-                {
-                    return event_density.upper_bound(x)->second;
-                }
-                else
-                {
-                    return event_density.cbegin()->second;
-                }
-            }
-        );
-        X_train[X_train.column(COLUMN)] = mapped_train_col;
+/*
+ * Replace a single column of the training and testing data with the mean
+ * training target observed for each of its values, see map_feature_y_density
+ */
+void
+remap_column(
+    num::array2d<real_type> & X_train,
+    num::array2d<real_type> & X_test,
+    const num::size_type COLUMN,
+    const std::valarray<real_type> & i_y_train
+)
+{
+    typedef std::valarray<real_type> vector_type;
+
+    const auto event_density = map_feature_y_density(X_train[X_train.column(COLUMN)], i_y_train);
+    std::cerr << "feature density size: " << event_density.size() << std::endl;
+
+    vector_type mapped_train_col = X_train[X_train.column(COLUMN)];
+    event_density.transform(std::begin(mapped_train_col), std::begin(mapped_train_col), mapped_train_col.size());
+    X_train[X_train.column(COLUMN)] = mapped_train_col;
 
+    if (X_test.shape().first != 0)
+    {
         vector_type mapped_test_col = X_test[X_test.column(COLUMN)];
-        std::transform(std::begin(mapped_test_col), std::end(mapped_test_col), std::begin(mapped_test_col),
-            [&event_density](const real_type & x) -> real_type
-            {
-                if (event_density.find(x) != event_density.cend())
-                {
-                    return event_density[x];
-                }
-                else if (event_density.upper_bound(x) != event_density.cend())
-                {
-                    return event_density.upper_bound(x)->second;
-                }
-                else
-                {
-                    return event_density.cbegin()->second;
-                }
-            }
-        );
+        event_density.transform(std::begin(mapped_test_col), std::begin(mapped_test_col), mapped_test_col.size());
         X_test[X_test.column(COLUMN)] = mapped_test_col;
     }
-
-    return std::make_pair(X_train, X_test);
 }
 
-
 std::pair<num::array2d<real_type>, num::array2d<real_type>>
-repair_X_data(
-    const num::array2d<real_type> & tr_array,
-    const num::array2d<real_type> & ts_array
+remap_X_data(
+    const enum ScenarioType scenario,
+    const num::array2d<real_type> & i_X_train,
+    const num::array2d<real_type> & i_X_test,
+    const std::valarray<real_type> & i_y_train
 )
 {
-    assert(tr_array.shape().second == ts_array.shape().second);
+    assert(i_X_train.shape().second == i_X_test.shape().second);
 
-    typedef std::valarray<real_type> vector_type;
     typedef num::array2d<real_type> array_type;
 
-    array_type tr_result = tr_array;
-    array_type ts_result = ts_array;
-
-    std::random_device rd;
-#ifdef NO_STOCH
-    std::mt19937 g(0);
-#else
-    std::mt19937 g(rd());
-#endif
-
-    auto draw_element = [&g](const vector_type & vec) -> real_type
-    {
-        std::uniform_int_distribution<num::size_type> dist{0, vec.size() - 1};
-
-        real_type drawn;
-
-        do
-        {
-#ifdef NO_STOCH
-            drawn = vec[rand() % vec.size()];
-#else
-            drawn = vec[dist(g)];
-#endif
-        } while (std::isnan(drawn));
-
-        return drawn;
-    };
+    array_type X_train = i_X_train;
+    array_type X_test = i_X_test;
 
-    for (num::size_type cidx{0}; cidx < tr_result.shape().second; ++cidx)
+    for (auto COLUMN : remap_columns(scenario))
     {
-        vector_type column(tr_result.shape().first + ts_result.shape().first);
-
-        column[std::slice(0, tr_result.shape().first, 1)] = tr_result[tr_result.column(cidx)];
-        column[std::slice(tr_result.shape().first, ts_result.shape().first, 1)] = ts_result[ts_result.column(cidx)];
-
-        for (num::size_type ridx{0}; ridx < tr_result.shape().first; ++ridx)
-        {
-            real_type & element = tr_result.at(ridx, cidx);
-            if (std::isnan(element))
-            {
-                element = draw_element(column);
-            }
-        }
-        for (num::size_type ridx{0}; ridx < ts_result.shape().first; ++ridx)
-        {
-            real_type & element = ts_result.at(ridx, cidx);
-            if (std::isnan(element))
-            {
-                element = draw_element(column);
-            }
-        }
+        remap_column(X_train, X_test, COLUMN, i_y_train);
     }
 
-    return std::make_pair(tr_result, ts_result);
+    return std::make_pair(X_train, X_test);
 }
 
-std::valarray<real_type>
-flatten_y_data(
-    const num::array2d<real_type> & array,
-    const std::vector<std::pair<num::size_type, num::size_type>> & subject_ranges
+/*
+ * Binned target encoders of the remap_columns, fitted once per predict
+ * call on the observed training values
+ */
+encoders_type
+fit_encoders(
+    const enum ScenarioType scenario,
+    const num::array2d<real_type> & X_tr_data,
+    const std::valarray<real_type> & y_tr_data,
+    const num::TargetEncoderCfg & cfg,
+    num::ThreadPool & pool
 )
 {
-    typedef std::valarray<real_type> vector_type;
-
-    vector_type result(subject_ranges.size());
+    encoders_type encoders;
 
-    std::transform(subject_ranges.cbegin(), subject_ranges.cend(), std::begin(result),
-        [&array](const std::pair<num::size_type, num::size_type> & range) -> real_type
-        {
-            return array.at(range.second, -1);
-        }
-    );
+    for (auto COLUMN : remap_columns(scenario))
+    {
+        encoders.emplace(COLUMN, num::TargetEncoder<real_type>(cfg))
+            .first->second.fit(X_tr_data[X_tr_data.column(COLUMN)], y_tr_data, pool);
+    }
 
-    return result;
+    return encoders;
 }
 
-num::array2d<real_type>
-flatten_X_data(
-    enum ScenarioType scenario,
-    const num::array2d<real_type> & array,
-    const std::vector<std::pair<num::size_type, num::size_type>> & subject_ranges
+/*
+ * remap_column with a fitted encoder instead of the exact value density
+ */
+void
+encode_column(
+    num::array2d<real_type> & X_train,
+    num::array2d<real_type> & X_test,
+    const num::size_type COLUMN,
+    const num::TargetEncoder<real_type> & encoder
 )
 {
     typedef std::valarray<real_type> vector_type;
-    typedef num::array2d<real_type> array_type;
 
-    const std::valarray<num::size_type> s2_selector[] =
+    vector_type mapped_train_col = X_train[X_train.column(COLUMN)];
+    encoder.transform_train(std::begin(mapped_train_col), std::begin(mapped_train_col), mapped_train_col.size());
+    X_train[X_train.column(COLUMN)] = mapped_train_col;
+
+    if (X_test.shape().first != 0)
     {
-        // these are column indices among those already selected from the full set
-        {2, 4, 5, 6, 7, 8, 9, 10, 11, 14, 15}, // age: 1
-        {2, 6}, // age: 123
-        {2, 4, 5, 6, 7, 8, 9}, // age: 366
-        {2, 3, 5, 6, 7, 8, 9}, // age: 1462
-        {2, 3, 5} // age: 2558
-    };
+        vector_type mapped_test_col = X_test[X_test.column(COLUMN)];
+        encoder.transform(std::begin(mapped_test_col), std::begin(mapped_test_col), mapped_test_col.size());
+        X_test[X_test.column(COLUMN)] = mapped_test_col;
+    }
+}
 
-    const std::valarray<num::size_type> s3_selector[] =
-    {
-        // these are column indices among those already selected from the full set
-        //                   site sex feed gage    apgar1,5
-        {2, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, /**/ 16, 17, /**/ 18, 19, 20, 21, 22, 23, 24, 25}, // age: 1
-        {2, 6}, // age: 123
-        {2, 4, 5, 6, 7, 8, 9}, // age: 366
-        {2, 3, 5, 6, 7, 8, 9}, // age: 1462
-        {2, 3, 5} // age: 2558
-    };
+/**
+ *******************************************************************************
+ *   @brief Observed values and missing cells of a training/testing pair
+ *******************************************************************************
+ *   @history @code
+ *   DATE         VERSION    WHO     DESCRIPTION
+ *   -----------  -------    ------  -----------
+ *   2026-10-19              wm      Class created.
+ *   @endcode
+ *******************************************************************************
+ *   Built once per predict call. For every column it keeps the pool of
+ *   values observed in the joint training and testing cohort and the
+ *   list of cells where the value is missing (NaN), so that imputing
+ *   a repetition costs one draw per missing cell.
+ *
+ *   Drawing uniformly from the pool is the same distribution as drawing
+ *   uniformly from the whole column and rejecting NaNs.
+ *
+ *   Without pool_testing only training values are drawn from, for
+ *   validation rows which must not inform their own imputation. A column
+ *   observed in validation rows only then falls back to those values.
+ *   Cells of a column observed nowhere are left NaN.
+ *
+ *   For predict_only the pool is made of the observed training values a
+ *   ScenarioModel keeps, and the missing cells are those of testing data
+ *   alone; fill is then given an empty training array.
+ *******************************************************************************
+ */
+class ImputationPool
+{
+public:
+    typedef num::array2d<real_type> array_type;
 
-    num::shape_type shape;
+    ImputationPool(const array_type & tr_array, const array_type & ts_array, bool pool_testing = true);
 
-    switch (scenario)
+    /*
+     * Pool of observed values as kept by values and value_offsets,
+     * for the missing cells of ts_array
+     */
+    ImputationPool(
+        std::vector<real_type> && values,
+        std::vector<num::size_type> && value_offsets,
+        const array_type & ts_array);
+
+    /*
+     * Overwrite missing cells of tr_array and ts_array (which must have
+     * the shapes of those the pool was built from) with random draws,
+     * but for columns with nothing observed to draw from
+     */
+    void fill(array_type & tr_array, array_type & ts_array, std::mt19937 & g) const;
+
+    num::size_type missing(void) const;
+    num::size_type missing(num::size_type cidx) const;
+
+    // training rows of the missing cells of column cidx, ascending
+    std::vector<num::size_type> missing_train_rows(num::size_type cidx) const;
+
+    const std::vector<real_type> & values(void) const;
+    const std::vector<num::size_type> & value_offsets(void) const;
+
+private:
+    const num::size_type m_ncols;
+    const num::size_type m_tr_size;
+
+    // observed values of column c are m_values[m_value_offsets[c], m_value_offsets[c + 1])
+    std::vector<real_type> m_values;
+    std::vector<num::size_type> m_value_offsets;
+
+    // likewise missing cells, as flat indices into training followed by testing data
+    std::vector<num::size_type> m_cells;
+    std::vector<num::size_type> m_cell_offsets;
+};
+
+ImputationPool::ImputationPool(const array_type & tr_array, const array_type & ts_array, bool pool_testing)
+:
+    m_ncols{tr_array.shape().second},
+    m_tr_size{tr_array.shape().first * tr_array.shape().second},
+    m_values{},
+    m_value_offsets{0},
+    m_cells{},
+    m_cell_offsets{0}
+{
+    assert(tr_array.shape().second == ts_array.shape().second);
+
+    const array_type * arrays[] = {&tr_array, &ts_array};
+    std::vector<real_type> ts_values;
+
+    for (num::size_type cidx{0}; cidx < m_ncols; ++cidx)
     {
-        case ScenarioType::S1:
-            shape = {subject_ranges.size(), 6};
-            break;
+        num::size_type base{0};
 
-        case ScenarioType::S2:
-            shape =
-                {
-                    subject_ranges.size(),
-                    std::accumulate(
-                        std::begin(s2_selector),
-                        std::end(s2_selector),
-                        0,
-                        [](const num::size_type & sum, const std::valarray<num::size_type> & selector)
-                        {
-                            return sum + selector.size();
-                        }
-                    )
-                };
-            break;
+        ts_values.clear();
+        for (const array_type * array : arrays)
+        {
+            for (num::size_type ridx{0}; ridx < array->shape().first; ++ridx)
+            {
+                const real_type element = array->at(ridx, cidx);
 
-        case ScenarioType::S3:
-            shape =
+                if (std::isnan(element))
                 {
-                    subject_ranges.size(),
-                    std::accumulate(
-                        std::begin(s3_selector),
-                        std::end(s3_selector),
-                        0,
-                        [](const num::size_type & sum, const std::valarray<num::size_type> & selector)
-                        {
-                            return sum + selector.size();
-                        }
-                    )
-                };
-            break;
+                    m_cells.push_back(base + ridx * m_ncols + cidx);
+                }
+                else if (array == &tr_array || pool_testing)
+                {
+                    m_values.push_back(element);
+                }
+                else
+                {
+                    ts_values.push_back(element);
+                }
+            }
+            base += array->shape().first * m_ncols;
+        }
+
+        if (m_values.size() == m_value_offsets.back())
+        {
+            m_values.insert(m_values.end(), ts_values.cbegin(), ts_values.cend());
+        }
+
+        m_value_offsets.push_back(m_values.size());
+        m_cell_offsets.push_back(m_cells.size());
+    }
+}
+
+ImputationPool::ImputationPool(
+    std::vector<real_type> && values,
+    std::vector<num::size_type> && value_offsets,
+    const array_type & ts_array)
+:
+    m_ncols{ts_array.shape().second},
+    m_tr_size{0},
+    m_values(std::move(values)),
+    m_value_offsets(std::move(value_offsets)),
+    m_cells{},
+    m_cell_offsets{0}
+{
+    assert(m_value_offsets.size() == m_ncols + 1);
+    assert(m_value_offsets.back() == m_values.size());
+
+    for (num::size_type cidx{0}; cidx < m_ncols; ++cidx)
+    {
+        for (num::size_type ridx{0}; ridx < ts_array.shape().first; ++ridx)
+        {
+            if (std::isnan(ts_array.at(ridx, cidx)))
+            {
+                m_cells.push_back(ridx * m_ncols + cidx);
+            }
+        }
+
+        m_cell_offsets.push_back(m_cells.size());
+    }
+}
+
+void
+ImputationPool::fill(array_type & tr_array, array_type & ts_array, std::mt19937 & g) const
+{
+    assert(tr_array.shape().first * tr_array.shape().second == m_tr_size);
+    assert(ts_array.shape().second == m_ncols);
+
+    real_type * const tr_data = tr_array.data();
+    real_type * const ts_data = ts_array.data();
+
+    for (num::size_type cidx{0}; cidx < m_ncols; ++cidx)
+    {
+        // nothing missing, or nothing observed to draw from
+        if (m_cell_offsets[cidx] == m_cell_offsets[cidx + 1] || m_value_offsets[cidx] == m_value_offsets[cidx + 1])
+        {
+            continue;
+        }
+
+        std::uniform_int_distribution<num::size_type> dist{m_value_offsets[cidx], m_value_offsets[cidx + 1] - 1};
+
+        for (num::size_type k{m_cell_offsets[cidx]}; k < m_cell_offsets[cidx + 1]; ++k)
+        {
+            const num::size_type cell{m_cells[k]};
+            const real_type drawn = m_values[dist(g)];
+
+            if (cell < m_tr_size)
+            {
+                tr_data[cell] = drawn;
+            }
+            else
+            {
+                ts_data[cell - m_tr_size] = drawn;
+            }
+        }
+    }
+}
+
+inline
+num::size_type
+ImputationPool::missing(void) const
+{
+    return m_cells.size();
+}
+
+inline
+num::size_type
+ImputationPool::missing(num::size_type cidx) const
+{
+    return m_cell_offsets[cidx + 1] - m_cell_offsets[cidx];
+}
+
+std::vector<num::size_type>
+ImputationPool::missing_train_rows(num::size_type cidx) const
+{
+    std::vector<num::size_type> rows;
+
+    // training cells come first within a column
+    for (num::size_type k{m_cell_offsets[cidx]}; k < m_cell_offsets[cidx + 1] && m_cells[k] < m_tr_size; ++k)
+    {
+        rows.push_back(m_cells[k] / m_ncols);
     }
 
-    array_type result(shape, NAN);
+    return rows;
+}
+
+inline
+const std::vector<real_type> &
+ImputationPool::values(void) const
+{
+    return m_values;
+}
+
+inline
+const std::vector<num::size_type> &
+ImputationPool::value_offsets(void) const
+{
+    return m_value_offsets;
+}
+
+/*
+ * Fill in missing (NaN) cells with values drawn at random from the same
+ * column of the joint training and testing cohort. All draws come from g,
+ * so concurrent repetitions only need a generator each.
+ */
+std::pair<num::array2d<real_type>, num::array2d<real_type>>
+repair_X_data(
+    const num::array2d<real_type> & tr_array,
+    const num::array2d<real_type> & ts_array,
+    const ImputationPool & pool,
+    std::mt19937 & g
+)
+{
+    typedef num::array2d<real_type> array_type;
+
+    array_type tr_result = tr_array;
+    array_type ts_result = ts_array;
+
+    pool.fill(tr_result, ts_result, g);
+
+    return std::make_pair(std::move(tr_result), std::move(ts_result));
+}
+
+/*
+ * Target of every subject, the last column of the subject table
+ */
+std::valarray<real_type>
+flatten_y_data(const num::Cohort<real_type> & cohort)
+{
+    return cohort.subjects[cohort.subjects.column(-1)];
+}
 
+/*
+ * Visits and their columns making up a row of the design, for
+ * flatten_X_data. S1 has a single visit per subject.
+ *
+ * Column indices run over the visit columns of load_data followed
+ * by its subject columns.
+ */
+num::VisitGrid<real_type>
+visit_grid(const enum ScenarioType scenario)
+{
 #if 0
     1: 3 5 6 7 8 9 10 12 14 17 18   // 11
     2: 3 7                          // 2
@@ -733,249 +1144,1356 @@ flatten_X_data(
 
 #endif
 
+    // these are column indices among those already selected from the full set
     switch (scenario)
     {
         case ScenarioType::S1:
-            result[result.columns(0, -1)] = array[array.columns(1, 6)];
-            break;
+            return {{1}, {{2, 3, 4, 5, 6, 7}}};
 
         case ScenarioType::S2:
-            for (num::size_type ridx{0}; ridx < subject_ranges.size(); ++ridx)
+            return
             {
-                const vector_type ages = array[std::gslice(
-                    // 1st column in subject_ranges[ridx].first'th row
-                    1 + subject_ranges[ridx].first * array.shape().second,
-                    // # of rows per range, 1 column stride
-                    {subject_ranges[ridx].second - subject_ranges[ridx].first + 1, 1},
-                    // every # elements, 1 column element step
-                    {array.shape().second, 1u}
-                )];
-
-                vector_type row(NAN, shape.second);
-                num::size_type age_idx{0};
-
-                auto mapper = [&ages, &row, &array, &subject_ranges, &ridx, &age_idx](
-                    const real_type age,
-                    const num::size_type row_idx,
-                    const std::valarray<num::size_type> & selector
-                ) -> num::size_type
+                {1, 123, 366, 1462, 2558},
                 {
-                    if (std::find(std::begin(ages), std::end(ages), age) != std::end(ages))
-                    {
-                        row[std::slice(row_idx, selector.size(), 1)] =
-                            array[array.row(subject_ranges[ridx].first + age_idx)][selector];
-                        ++age_idx;
-                    }
-
-                    return row_idx + selector.size();
-                };
-
-                num::size_type oidx{0};
-
-                oidx = mapper(1, oidx, s2_selector[0]);
-                oidx = mapper(123, oidx, s2_selector[1]);
-                oidx = mapper(366, oidx, s2_selector[2]);
-                oidx = mapper(1462, oidx, s2_selector[3]);
-                oidx = mapper(2558, oidx, s2_selector[4]);
-
-                assert(oidx == row.size());
-                assert(age_idx == (subject_ranges[ridx].second - subject_ranges[ridx].first + 1));
-
-                result[result.row(ridx)] = row;
-//                if (ridx < 25)
-//                {
-//                    std::copy(std::begin(row), std::end(row), std::ostream_iterator<real_type>(std::cerr, " "));
-//                    std::cerr << std::endl;
-//                }
-            }
-            break;
+                    {2, 4, 5, 6, 7, 8, 9, 10, 11, 14, 15},
+                    {2, 6},
+                    {2, 4, 5, 6, 7, 8, 9},
+                    {2, 3, 5, 6, 7, 8, 9},
+                    {2, 3, 5}
+                }
+            };
 
         case ScenarioType::S3:
-            for (num::size_type ridx{0}; ridx < subject_ranges.size(); ++ridx)
+        default:
+            return
             {
-                const vector_type ages = array[std::gslice(
-                    // 1st column in subject_ranges[ridx].first'th row
-                    1 + subject_ranges[ridx].first * array.shape().second,
-                    // # of rows per range, 1 column stride
-                    {subject_ranges[ridx].second - subject_ranges[ridx].first + 1, 1},
-                    // every # elements, 1 column element step
-                    {array.shape().second, 1u}
-                )];
-
-                vector_type row(NAN, shape.second);
-                num::size_type age_idx{0};
-
-                auto mapper = [&ages, &row, &array, &subject_ranges, &ridx, &age_idx](
-                    const real_type age,
-                    const num::size_type row_idx,
-                    const std::valarray<num::size_type> & selector
-                ) -> num::size_type
+                {1, 123, 366, 1462, 2558},
                 {
-                    if (std::find(std::begin(ages), std::end(ages), age) != std::end(ages))
-                    {
-                        row[std::slice(row_idx, selector.size(), 1)] =
-                            array[array.row(subject_ranges[ridx].first + age_idx)][selector];
-                        ++age_idx;
-                    }
+                    //                   site sex feed gage    apgar1,5
+                    {2, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, /**/ 16, 17, /**/ 18, 19, 20, 21, 22, 23, 24, 25},
+                    {2, 6},
+                    {2, 4, 5, 6, 7, 8, 9},
+                    {2, 3, 5, 6, 7, 8, 9},
+                    {2, 3, 5}
+                }
+            };
+    }
+}
 
-                    return row_idx + selector.size();
-                };
+/*
+ * One row per subject, its visits (visit column 1 holds the age in days)
+ * pivoted onto grid, see num::pivot_visits
+ */
+num::array2d<real_type>
+flatten_X_data(
+    const num::Cohort<real_type> & cohort,
+    const num::VisitGrid<real_type> & grid,
+    num::ThreadPool & pool
+)
+{
+    return num::pivot_visits(cohort, 1, grid, pool);
+}
 
-                num::size_type oidx{0};
+/**
+ *******************************************************************************
+ *   @brief Configuration for @c ChildStuntedness5
+ *******************************************************************************
+ *   @history @code
+ *   DATE         VERSION    WHO     DESCRIPTION
+ *   -----------  -------    ------  -----------
+ *   2026-10-19              wm      Class created.
+ *   @endcode
+ *******************************************************************************
+ */
+struct PredictCfg
+{
+    PredictCfg()
+    :
+        m_solver{num::Solver::FMinCG},
+        m_threads{0},
+        m_encoding{TargetEncoding::Exact},
+        m_encoder{},
+        m_implicit_interactions{false},
+        m_pairs{},
+        m_model{Model::Linear},
+        m_fm_rank{4},
+        m_visit_grids{},
+        m_time_budget{0},
+        m_ensemble_tol{0},
+#ifdef NO_STOCH
+        m_seed{0}
+#else
+        m_seed{std::random_device()()}
+#endif
+    {}
 
-                oidx = mapper(1, oidx, s3_selector[0]);
-                oidx = mapper(123, oidx, s3_selector[1]);
-                oidx = mapper(366, oidx, s3_selector[2]);
-                oidx = mapper(1462, oidx, s3_selector[3]);
-                oidx = mapper(2558, oidx, s3_selector[4]);
+    num::Solver solver(void) const
+    {
+        return m_solver;
+    }
 
-                assert(oidx == row.size());
-                assert(age_idx == (subject_ranges[ridx].second - subject_ranges[ridx].first + 1));
+    /*
+     * Solver::Normal keeps the Gram matrix across imputation repetitions
+     * and updates it incrementally, see do_lin_reg_gram
+     */
+    PredictCfg & solver(num::Solver _solver)
+    {
+        m_solver = _solver;
+        return *this;
+    }
 
-                result[result.row(ridx)] = row;
-//                if (ridx < 25)
-//                {
-//                    std::copy(std::begin(row), std::end(row), std::ostream_iterator<real_type>(std::cerr, " "));
-//                    std::cerr << std::endl;
-//                }
-            }
-            break;
+    num::size_type threads(void) const
+    {
+        return m_threads;
     }
 
-    return result;
-}
+    /*
+     * Number of imputation repetitions run concurrently,
+     * 0 means one per hardware thread
+     */
+    PredictCfg & threads(num::size_type _threads)
+    {
+        m_threads = _threads;
+        return *this;
+    }
 
-struct ChildStuntedness5
-{
-    enum TestType
+    unsigned int seed(void) const
     {
-        Example,
-        Provisional,
-        System
-    };
+        return m_seed;
+    }
 
-    std::vector<double>
-    predict(
-        int testType,
-        int scenario,
-        std::vector<std::string> & training,
-        std::vector<std::string> & testing) const;
+    /*
+     * Root of all random draws made by predict, equal seeds give
+     * equal predictions regardless of threads or concurrent callers
+     */
+    PredictCfg & seed(unsigned int _seed)
+    {
+        m_seed = _seed;
+        return *this;
+    }
 
-    std::vector<double>
-    predict(
-        int testType,
-        int scenario,
-        std::vector<std::string> && training,
-        std::vector<std::string> && testing) const;
-};
+    TargetEncoding encoding(void) const
+    {
+        return m_encoding;
+    }
 
-std::vector<double>
-ChildStuntedness5::predict(
-    int testType,
-    int scenario,
-    std::vector<std::string> & training,
-    std::vector<std::string> & testing) const
-{
-    return predict(testType, scenario, std::move(training), std::move(testing));
-}
+    /*
+     * How remap_columns get target encoded, with TargetEncoding::Binned
+     * the encoders are set up by encoder()
+     */
+    PredictCfg & encoding(TargetEncoding _encoding)
+    {
+        m_encoding = _encoding;
+        return *this;
+    }
 
-std::vector<double>
-ChildStuntedness5::predict(
-    int testType,
-    int scenario,
-    std::vector<std::string> && i_training,
-    std::vector<std::string> && i_testing) const
-{
-    assert(scenario <= ScenarioType::S3);
+    const num::TargetEncoderCfg & encoder(void) const
+    {
+        return m_encoder;
+    }
 
-    enum col
+    PredictCfg & encoder(const num::TargetEncoderCfg & _encoder)
     {
-        subjid,
-        agedays,
-        wtkg,
-        htcm,
-        lencm,
-        bmi,
-        waz,
-        haz,
-        whz,
-        baz,
-        siteid,
-        sexn,
-        feedingn,
-        gagebrth,
-        birthwt,
-        birthlen,
-        apgar1,
-        apgar5,
-        mage,
-        demo1n,
-        mmaritn,
-        mcignum,
-        parity,
-        gravida,
-        meducyrs,
-        demo2n,
-        geniq
-    };
+        m_encoder = _encoder;
+        return *this;
+    }
 
-    std::cerr << "Test: " << testType << " , Scenario: " << scenario << std::endl;
+    bool implicit_interactions(void) const
+    {
+        return m_implicit_interactions;
+    }
 
-    typedef num::array2d<real_type> array_type;
-    typedef std::valarray<real_type> vector_type;
+    /*
+     * Pairwise products are not materialized but computed on the fly
+     * by num::InteractionDesign, ignored by Solver::Normal
+     */
+    PredictCfg & implicit_interactions(bool _implicit_interactions)
+    {
+        m_implicit_interactions = _implicit_interactions;
+        return *this;
+    }
 
-    const std::vector<std::pair<num::size_type, num::size_type>> tr_subject_ranges =
-        extract_subject_ranges(std::vector<std::string>{i_training});
-    const std::vector<std::pair<num::size_type, num::size_type>> ts_subject_ranges =
-        extract_subject_ranges(std::vector<std::string>{i_testing});
+    /*
+     * Pairs of feature columns multiplied into the design,
+     * feature_pairs unless set for the scenario; throws
+     * std::out_of_range if those set do not fit N columns
+     */
+    std::valarray<std::pair<num::size_type, num::size_type>> pairs(int scenario, num::size_type N) const
+    {
+        const auto found = m_pairs.find(scenario);
 
-    auto na_xlt = [](const char * str) -> real_type
+        if (found != m_pairs.cend())
+        {
+            check_feature_pairs(found->second, N);
+
+            return found->second;
+        }
+
+        return feature_pairs(static_cast<enum ScenarioType>(scenario), N);
+    }
+
+    /*
+     * Per scenario overrides, e.g. from read_feature_pairs
+     */
+    PredictCfg & pairs(const std::map<int, std::valarray<std::pair<num::size_type, num::size_type>>> & _pairs)
     {
-        return (std::strcmp(str, "NA") == 0) ? NAN : std::strtod(str, nullptr);
-    };
+        m_pairs = _pairs;
+        return *this;
+    }
 
-    const num::loadtxtCfg<real_type>::use_cols_type tr_use_cols[] =
+    Model model(void) const
     {
+        return m_model;
+    }
+
+    /*
+     * With Model::FM the solver setting is not used, the machine
+     * is always fitted with fmincg
+     */
+    PredictCfg & model(Model _model)
+    {
+        m_model = _model;
+        return *this;
+    }
+
+    num::size_type fm_rank(void) const
+    {
+        return m_fm_rank;
+    }
+
+    /*
+     * Number of latent factors per feature of Model::FM
+     */
+    PredictCfg & fm_rank(num::size_type _fm_rank)
+    {
+        m_fm_rank = _fm_rank;
+        return *this;
+    }
+
+    /*
+     * Visits pivoted into a design row, visit_grid unless set for the scenario
+     */
+    num::VisitGrid<real_type> visit_grid(int scenario) const
+    {
+        const auto found = m_visit_grids.find(scenario);
+
+        return found != m_visit_grids.cend() ? found->second : ::visit_grid(static_cast<enum ScenarioType>(scenario));
+    }
+
+    /*
+     * Per scenario overrides, for cohorts visited at other ages
+     */
+    PredictCfg & visit_grids(const std::map<int, num::VisitGrid<real_type>> & _visit_grids)
+    {
+        m_visit_grids = _visit_grids;
+        return *this;
+    }
+
+    double time_budget(void) const
+    {
+        return m_time_budget;
+    }
+
+    /*
+     * Seconds a call to predict may take, 0 for no limit. Imputation
+     * repetitions which are not expected to complete in time are left
+     * out of the average, the first one is always run.
+     */
+    PredictCfg & time_budget(double _time_budget)
+    {
+        m_time_budget = _time_budget;
+        return *this;
+    }
+
+    double ensemble_tol(void) const
+    {
+        return m_ensemble_tol;
+    }
+
+    /*
+     * With a positive tolerance predict stops adding imputation
+     * repetitions to the average once its estimated Monte Carlo error
+     * (root mean over subjects of the standard error) is below it,
+     * NREP repetitions remaining the cap. 0 always averages NREP.
+     */
+    PredictCfg & ensemble_tol(double _ensemble_tol)
+    {
+        m_ensemble_tol = _ensemble_tol;
+        return *this;
+    }
+
+    num::Solver m_solver;
+    num::size_type m_threads;
+    TargetEncoding m_encoding;
+    num::TargetEncoderCfg m_encoder;
+    bool m_implicit_interactions;
+    std::map<int, std::valarray<std::pair<num::size_type, num::size_type>>> m_pairs;
+    Model m_model;
+    num::size_type m_fm_rank;
+    std::map<int, num::VisitGrid<real_type>> m_visit_grids;
+    double m_time_budget;
+    double m_ensemble_tol;
+    unsigned int m_seed;
+};
+
+/*
+ * Generator for a single imputation repetition, its stream depends
+ * on (seed, scenario, repetition) only and not on which thread,
+ * or in which order, the repetition gets executed.
+ */
+std::mt19937
+rep_engine(unsigned int seed, int scenario, num::size_type rep)
+{
+    std::seed_seq seq{
+        seed,
+        static_cast<unsigned int>(scenario),
+        static_cast<unsigned int>(rep)};
+
+    return std::mt19937(seq);
+}
+
+std::pair<num::array2d<real_type>, num::array2d<real_type>>
+make_design_matrices(
+    const enum ScenarioType scenario,
+    const num::array2d<real_type> & X_tr_data,
+    const num::array2d<real_type> & X_ts_data,
+    const std::valarray<real_type> & y_tr_data,
+    const ImputationPool & pool,
+    std::mt19937 & g
+)
+{
+    typedef num::array2d<real_type> array_type;
+
+    auto X_tr_ts_data = repair_X_data(X_tr_data, X_ts_data, pool, g);
+    array_type complete_X_tr_data = std::move(X_tr_ts_data.first);
+    array_type complete_X_ts_data = std::move(X_tr_ts_data.second);
+
+    X_tr_ts_data = remap_X_data(scenario, complete_X_tr_data, complete_X_ts_data, y_tr_data);
+    complete_X_tr_data = std::move(X_tr_ts_data.first);
+    complete_X_ts_data = std::move(X_tr_ts_data.second);
+
+    complete_X_tr_data = preprocess_features(scenario, std::move(complete_X_tr_data));
+    complete_X_ts_data = preprocess_features(scenario, std::move(complete_X_ts_data));
+
+    return std::make_pair(std::move(complete_X_tr_data), std::move(complete_X_ts_data));
+}
+
+/**
+ *******************************************************************************
+ *   @brief @c make_design_matrices and @c standardize_X_data over repetitions
+ *******************************************************************************
+ *   @history @code
+ *   DATE         VERSION    WHO     DESCRIPTION
+ *   -----------  -------    ------  -----------
+ *   2026-10-19              wm      Class created.
+ *   @endcode
+ *******************************************************************************
+ *   Between imputation repetitions only columns with missing cells change.
+ *   The pipeline keeps the output of every stage and on each @c draw
+ *   recomputes only what depends on an imputed column: its remapping,
+ *   every pairwise product it takes part in, and the standardization
+ *   of all of those. The first @c draw computes everything. The results
+ *   are bit-identical to running the stages from scratch.
+ *
+ *   Given fitted encoders, the remapped columns are target encoded with
+ *   them rather than with remap_column.
+ *******************************************************************************
+ */
+class DesignPipeline
+{
+public:
+    typedef num::array2d<real_type> array_type;
+    typedef std::valarray<real_type> vector_type;
+
+    DesignPipeline(
+        const enum ScenarioType scenario,
+        const std::valarray<std::pair<num::size_type, num::size_type>> & pairs,
+        const array_type & X_tr_data,
+        const array_type & X_ts_data,
+        const vector_type & y_tr_data,
+        const ImputationPool & pool,
+        DesignOutput output = DesignOutput::Standardized,
+        const encoders_type * encoders = nullptr);
+
+    /*
+     * Next repetition: impute with draws from g and bring the dependent
+     * stages up to date
+     */
+    void draw(std::mt19937 & g);
+
+    // design matrices as make_design_matrices returns them,
+    // without the products for DesignOutput::Implicit
+    const array_type & train(void) const;
+    const array_type & test(void) const;
+
+    // the same passed through standardize_X_data, for DesignOutput::Standardized
+    const array_type & std_train(void) const;
+    const array_type & std_test(void) const;
+
+    // imputed training data, before the remapping
+    const array_type & imputed_train(void) const;
+
+    // pairs of base columns whose products make up the rest of the design
+    const std::valarray<std::pair<num::size_type, num::size_type>> & pairs(void) const;
+
+    // columns of the design recomputed by the last draw
+    num::size_type recomputed_columns(void) const;
+
+    // rows of the training design a draw after the first may change, for
+    // num::GramCache: rows of column c are
+    // train_cells()[train_cell_offsets()[c], train_cell_offsets()[c + 1])
+    const std::vector<num::size_type> & train_cells(void) const;
+    const std::vector<num::size_type> & train_cell_offsets(void) const;
+
+private:
+    const vector_type m_y;
+    const ImputationPool & m_pool;
+    const DesignOutput m_output;
+    const encoders_type * m_encoders;
+    const std::valarray<std::pair<num::size_type, num::size_type>> m_pairs;
+
+    std::vector<bool> m_remapped;
+
+    array_type m_imp_tr;
+    array_type m_imp_ts;
+    array_type m_tr;
+    array_type m_ts;
+    array_type m_std_tr;
+    array_type m_std_ts;
+
+    std::vector<num::size_type> m_train_cells;
+    std::vector<num::size_type> m_train_cell_offsets;
+
+    bool m_first;
+    num::size_type m_recomputed;
+};
+
+DesignPipeline::DesignPipeline(
+    const enum ScenarioType scenario,
+    const std::valarray<std::pair<num::size_type, num::size_type>> & pairs,
+    const array_type & X_tr_data,
+    const array_type & X_ts_data,
+    const vector_type & y_tr_data,
+    const ImputationPool & pool,
+    DesignOutput output,
+    const encoders_type * encoders)
+:
+    m_y(y_tr_data),
+    m_pool(pool),
+    m_output{output},
+    m_encoders{encoders},
+    m_pairs(pairs),
+    m_remapped(X_tr_data.shape().second, false),
+    m_imp_tr(X_tr_data),
+    m_imp_ts(X_ts_data),
+    m_tr(num::zeros<real_type>({X_tr_data.shape().first,
+        X_tr_data.shape().second + (output != DesignOutput::Implicit ? m_pairs.size() : 0)})),
+    m_ts(num::zeros<real_type>({X_ts_data.shape().first,
+        X_ts_data.shape().second + (output != DesignOutput::Implicit ? m_pairs.size() : 0)})),
+    m_std_tr(num::ones<real_type>({
+        output == DesignOutput::Standardized ? X_tr_data.shape().first : 0, m_tr.shape().second + 1})),
+    m_std_ts(num::ones<real_type>({
+        output == DesignOutput::Standardized ? X_ts_data.shape().first : 0, m_ts.shape().second + 1})),
+    m_train_cells{},
+    m_train_cell_offsets{0},
+    m_first{true},
+    m_recomputed{0}
+{
+    for (auto c : remap_columns(scenario))
+    {
+        m_remapped[c] = true;
+    }
+
+    const num::size_type M{X_tr_data.shape().first};
+    const num::size_type N{X_tr_data.shape().second};
+
+    // an imputed column changes in its missing rows, or in full when
+    // remap_column maps it by a density of the whole column
+    std::vector<std::vector<num::size_type>> rows(m_tr.shape().second);
+
+    for (num::size_type c{0}; c < N; ++c)
+    {
+        if (m_pool.missing(c) == 0)
         {
-            col::subjid,
-            col::sexn,
-            col::gagebrth, col::birthwt, col::birthlen, col::apgar1, col::apgar5,
-            col::geniq
-        },
+            continue;
+        }
+        if (m_remapped[c] && m_encoders == nullptr)
         {
-            col::subjid,
-            col::agedays, col::wtkg, col::htcm, col::lencm, col::bmi, col::waz, col::haz, col::whz, col::baz,
-            col::sexn,
-            col::gagebrth, col::birthwt, col::birthlen, col::apgar1, col::apgar5,
-            col::geniq
-        },
+            rows[c].resize(M);
+            std::iota(rows[c].begin(), rows[c].end(), 0);
+        }
+        else
         {
-            col::subjid,
-            col::agedays, col::wtkg, col::htcm, col::lencm, col::bmi, col::waz, col::haz, col::whz, col::baz,
-            col::siteid,
-            col::sexn,
-            col::feedingn,
-            col::gagebrth, col::birthwt, col::birthlen, col::apgar1, col::apgar5,
-            col::mage, col::demo1n, col::mmaritn, col::mcignum, col::parity, col::gravida, col::meducyrs, col::demo2n,
-            col::geniq
+            rows[c] = m_pool.missing_train_rows(c);
+        }
+    }
+
+    // and a product wherever either of its factors does
+    for (num::size_type pidx{0}; N + pidx < rows.size(); ++pidx)
+    {
+        const auto & lhs = rows[m_pairs[pidx].first];
+        const auto & rhs = rows[m_pairs[pidx].second];
+
+        std::set_union(lhs.cbegin(), lhs.cend(), rhs.cbegin(), rhs.cend(), std::back_inserter(rows[N + pidx]));
+    }
+
+    for (const auto & col_rows : rows)
+    {
+        m_train_cells.insert(m_train_cells.end(), col_rows.cbegin(), col_rows.cend());
+        m_train_cell_offsets.push_back(m_train_cells.size());
+    }
+}
+
+void
+DesignPipeline::draw(std::mt19937 & g)
+{
+    const num::size_type N{m_imp_tr.shape().second};
+
+    m_pool.fill(m_imp_tr, m_imp_ts, g);
+
+    std::vector<bool> dirty(m_tr.shape().second);
+
+    // imputed and remapped base columns
+    for (num::size_type c{0}; c < N; ++c)
+    {
+        dirty[c] = m_first || m_pool.missing(c) != 0;
+
+        if (dirty[c])
+        {
+            m_tr[m_tr.column(c)] = m_imp_tr[m_imp_tr.column(c)];
+            m_ts[m_ts.column(c)] = m_imp_ts[m_imp_ts.column(c)];
+
+            if (m_remapped[c] && m_encoders != nullptr)
+            {
+                encode_column(m_tr, m_ts, c, m_encoders->at(c));
+            }
+            else if (m_remapped[c])
+            {
+                remap_column(m_tr, m_ts, c, m_y);
+            }
+        }
+    }
+
+    // their products
+    for (num::size_type pidx{0}; N + pidx < dirty.size(); ++pidx)
+    {
+        const auto & pair = m_pairs[pidx];
+
+        dirty[N + pidx] = dirty[pair.first] || dirty[pair.second];
+
+        if (dirty[N + pidx])
+        {
+            m_tr[m_tr.column(N + pidx)] =
+                (vector_type)m_tr[m_tr.column(pair.first)] * (vector_type)m_tr[m_tr.column(pair.second)];
+            m_ts[m_ts.column(N + pidx)] =
+                (vector_type)m_ts[m_ts.column(pair.first)] * (vector_type)m_ts[m_ts.column(pair.second)];
+        }
+    }
+
+    m_recomputed = std::count(dirty.cbegin(), dirty.cend(), true);
+
+    // and standardization of all the above
+    if (m_output == DesignOutput::Standardized)
+    {
+        for (num::size_type c{0}; c < dirty.size(); ++c)
+        {
+            if (dirty[c])
+            {
+                m_std_tr[m_std_tr.column(c + 1)] = m_tr[m_tr.column(c)];
+                m_std_ts[m_std_ts.column(c + 1)] = m_ts[m_ts.column(c)];
+
+                standardize_column(m_std_tr, m_std_ts, c + 1);
+            }
+        }
+    }
+
+    m_first = false;
+}
+
+inline
+const DesignPipeline::array_type &
+DesignPipeline::train(void) const
+{
+    return m_tr;
+}
+
+inline
+const DesignPipeline::array_type &
+DesignPipeline::test(void) const
+{
+    return m_ts;
+}
+
+inline
+const DesignPipeline::array_type &
+DesignPipeline::std_train(void) const
+{
+    return m_std_tr;
+}
+
+inline
+const DesignPipeline::array_type &
+DesignPipeline::std_test(void) const
+{
+    return m_std_ts;
+}
+
+inline
+const DesignPipeline::array_type &
+DesignPipeline::imputed_train(void) const
+{
+    return m_imp_tr;
+}
+
+inline
+const std::valarray<std::pair<num::size_type, num::size_type>> &
+DesignPipeline::pairs(void) const
+{
+    return m_pairs;
+}
+
+inline
+num::size_type
+DesignPipeline::recomputed_columns(void) const
+{
+    return m_recomputed;
+}
+
+inline
+const std::vector<num::size_type> &
+DesignPipeline::train_cells(void) const
+{
+    return m_train_cells;
+}
+
+inline
+const std::vector<num::size_type> &
+DesignPipeline::train_cell_offsets(void) const
+{
+    return m_train_cell_offsets;
+}
+
+/**
+ *******************************************************************************
+ *   @brief Linear ensemble of a scenario, trained once and saved for reuse
+ *******************************************************************************
+ *   @history @code
+ *   DATE         VERSION    WHO     DESCRIPTION
+ *   -----------  -------    ------  -----------
+ *   2026-10-19              wm      Class created.
+ *   @endcode
+ *******************************************************************************
+ *   Holds what scoring new subjects takes from the training ones, made by
+ *   ChildStuntedness5::train and used by ChildStuntedness5::predict_only:
+ *   the observed training values imputation draws from, the feature
+ *   pairs, and for every imputation repetition the target encoding of
+ *   the remapped columns, the mean and deviation of every design column
+ *   and the regression coefficients. Binned encodings are fitted once,
+ *   so they are kept once rather than per repetition.
+ *
+ *   The model is a num:: blob, the same in memory as on disk: save writes
+ *   its bytes, and a model of a mapped file reads its arrays in place.
+ *******************************************************************************
+ */
+class ScenarioModel
+{
+public:
+    typedef num::array2d<real_type> array_type;
+    typedef std::valarray<real_type> vector_type;
+
+    /*
+     * The arrays a model is made of, as collected by training
+     */
+    struct Parts
+    {
+        int scenario;
+        TargetEncoding encoding;
+        unsigned int seed;
+        num::size_type ncols;
+        num::size_type nrep;
+
+        // (first, second) of every pair, in a row
+        std::vector<num::size_type> pairs;
+        std::vector<num::size_type> remapped;
+
+        // see ImputationPool::values and ImputationPool::value_offsets
+        std::vector<real_type> values;
+        std::vector<num::size_type> value_offsets;
+
+        // encoding of remapped column k in repetition rep is number
+        // rep * remapped.size() + k (0 * ... for Binned) of keys and of
+        // tables: a num::DensityTable's keys and values, or {lo, width}
+        // and the table of a num::TargetEncoder
+        std::vector<real_type> keys;
+        std::vector<num::size_type> key_offsets;
+        std::vector<real_type> tables;
+        std::vector<num::size_type> table_offsets;
+
+        // per repetition, design columns enter the regression
+        // as (x - mu) / dev, intercept first in theta
+        std::vector<real_type> theta;
+        std::vector<real_type> mu;
+        std::vector<real_type> dev;
+    };
+
+    explicit ScenarioModel(const Parts & parts);
+
+    /*
+     * Model of a mapped file written by save; a file which cannot be
+     * mapped or is not a valid model throws std::runtime_error
+     */
+    explicit ScenarioModel(std::shared_ptr<const num::MappedFile> file);
+
+    void save(std::ostream & os) const;
+
+    // size of the blob, as saved
+    num::size_type bytes(void) const;
+
+    int scenario(void) const;
+    unsigned int seed(void) const;
+    num::size_type columns(void) const;
+    num::size_type repetitions(void) const;
+
+    /*
+     * Pool of the training values for the missing cells of the flattened
+     * testing data X
+     */
+    ImputationPool imputation_pool(const array_type & X) const;
+
+    /*
+     * Target encodes the remapped columns of X, imputed, as in repetition rep
+     */
+    void encode(num::size_type rep, array_type & X) const;
+
+    /*
+     * Prediction of repetition rep for the rows of X, imputed and encoded
+     */
+    vector_type score(num::size_type rep, const array_type & X) const;
+
+private:
+    static constexpr num::size_type MAGIC{0x4c444f4d35534343};
+    static constexpr num::size_type VERSION{1};
+
+    enum header
+    {
+        magic,
+        version,
+        value_size,
+        scenario_no,
+        encoding_no,
+        seed_no,
+        ncols,
+        nrep,
+        HEADER_SIZE
+    };
+
+    void parse(void);
+
+    std::shared_ptr<const void> m_owner;
+    const char * m_data;
+    num::size_type m_size;
+
+    num::BlobArray<num::size_type> m_header;
+    num::BlobArray<num::size_type> m_pairs;
+    num::BlobArray<num::size_type> m_remapped;
+    num::BlobArray<real_type> m_values;
+    num::BlobArray<num::size_type> m_value_offsets;
+    num::BlobArray<real_type> m_keys;
+    num::BlobArray<num::size_type> m_key_offsets;
+    num::BlobArray<real_type> m_tables;
+    num::BlobArray<num::size_type> m_table_offsets;
+    num::BlobArray<real_type> m_theta;
+    num::BlobArray<real_type> m_mu;
+    num::BlobArray<real_type> m_dev;
+};
+
+constexpr num::size_type ScenarioModel::MAGIC;
+constexpr num::size_type ScenarioModel::VERSION;
+
+ScenarioModel::ScenarioModel(const Parts & parts)
+{
+    const std::vector<num::size_type> head =
+    {
+        MAGIC,
+        VERSION,
+        sizeof (real_type),
+        static_cast<num::size_type>(parts.scenario),
+        static_cast<num::size_type>(parts.encoding),
+        parts.seed,
+        parts.ncols,
+        parts.nrep
+    };
+
+    num::BlobWriter writer;
+    writer
+        .put(head)
+        .put(parts.pairs)
+        .put(parts.remapped)
+        .put(parts.values)
+        .put(parts.value_offsets)
+        .put(parts.keys)
+        .put(parts.key_offsets)
+        .put(parts.tables)
+        .put(parts.table_offsets)
+        .put(parts.theta)
+        .put(parts.mu)
+        .put(parts.dev);
+
+    const auto bytes = std::make_shared<const std::vector<char>>(writer.release());
+
+    m_owner = bytes;
+    m_data = bytes->data();
+    m_size = bytes->size();
+
+    parse();
+}
+
+ScenarioModel::ScenarioModel(std::shared_ptr<const num::MappedFile> file)
+:
+    m_owner(file),
+    m_data(file->data()),
+    m_size{file->size()}
+{
+    if (!*file)
+    {
+        throw std::runtime_error("model: file could not be mapped");
+    }
+
+    parse();
+}
+
+void
+ScenarioModel::parse(void)
+{
+    // a file may be truncated, foreign or corrupt: every size and index
+    // is checked before use, with arithmetic that cannot overflow
+    auto check = [](bool ok, const char * what)
+    {
+        if (!ok)
+        {
+            throw std::runtime_error(std::string("model: ") + what);
+        }
+    };
+    auto product = [&check](num::size_type lhs, num::size_type rhs) -> num::size_type
+    {
+        check(rhs == 0 || lhs <= std::numeric_limits<num::size_type>::max() / rhs, "sizes overflow");
+        return lhs * rhs;
+    };
+    // offsets into an array of total elements, count + 1 of them, ascending
+    auto check_offsets = [&check](const num::BlobArray<num::size_type> & offsets, num::size_type count,
+        num::size_type total, const char * what)
+    {
+        check(offsets.size == count + 1 && offsets[0] == 0 && offsets[count] == total, what);
+        check(std::is_sorted(offsets.begin(), offsets.end()), what);
+    };
+
+    num::BlobReader reader(m_data, m_size);
+
+    m_header = reader.take<num::size_type>();
+
+    check(m_header.size == HEADER_SIZE && m_header[magic] == MAGIC, "not a model file");
+    check(m_header[version] == VERSION, "unsupported version");
+    check(m_header[value_size] == sizeof (real_type), "written by a build with another real_type");
+    check(m_header[scenario_no] <= ScenarioType::S3, "bad scenario");
+    check(m_header[encoding_no] == static_cast<num::size_type>(TargetEncoding::Exact) ||
+        m_header[encoding_no] == static_cast<num::size_type>(TargetEncoding::Binned), "bad encoding");
+
+    m_pairs = reader.take<num::size_type>();
+    m_remapped = reader.take<num::size_type>();
+    m_values = reader.take<real_type>();
+    m_value_offsets = reader.take<num::size_type>();
+    m_keys = reader.take<real_type>();
+    m_key_offsets = reader.take<num::size_type>();
+    m_tables = reader.take<real_type>();
+    m_table_offsets = reader.take<num::size_type>();
+    m_theta = reader.take<real_type>();
+    m_mu = reader.take<real_type>();
+    m_dev = reader.take<real_type>();
+
+    check(reader.done(), "trailing bytes");
+
+    const bool binned{static_cast<TargetEncoding>(m_header[encoding_no]) == TargetEncoding::Binned};
+    const num::size_type N{columns()};
+    const num::size_type NREP{repetitions()};
+
+    // every array is within the blob, so sizes derived from them cannot overflow
+    check(N != 0 && N < m_size && NREP != 0, "bad columns or repetitions");
+    check(m_pairs.size % 2 == 0, "bad pairs");
+    for (const auto c : m_pairs)
+    {
+        check(c < N, "pair column out of range");
+    }
+    for (const auto c : m_remapped)
+    {
+        check(c < N, "remapped column out of range");
+    }
+
+    const num::size_type W{N + m_pairs.size / 2};
+    const num::size_type NTABLES{product(binned ? 1 : NREP, m_remapped.size)};
+
+    check_offsets(m_value_offsets, N, m_values.size, "bad imputation pool");
+    check(NTABLES < m_size, "bad encodings");
+    check_offsets(m_key_offsets, NTABLES, m_keys.size, "bad encoding keys");
+    check_offsets(m_table_offsets, NTABLES, m_tables.size, "bad encoding tables");
+
+    for (num::size_type t{0}; t < NTABLES; ++t)
+    {
+        const num::size_type nkeys{m_key_offsets[t + 1] - m_key_offsets[t]};
+        const num::size_type nvalues{m_table_offsets[t + 1] - m_table_offsets[t]};
+        const real_type * keys = m_keys.data + m_key_offsets[t];
+
+        if (binned)
+        {
+            // {lo, width}, nbins means and the prior
+            check(nkeys == 2 && keys[1] > 0 && nvalues >= 2, "bad binned encoding");
+        }
+        else
+        {
+            check(nkeys != 0 && nkeys == nvalues, "bad exact encoding");
+            check(std::adjacent_find(keys, keys + nkeys,
+                [](real_type lhs, real_type rhs){ return !(lhs < rhs); }) == keys + nkeys, "unsorted exact encoding");
+        }
+    }
+
+    check(m_theta.size == product(NREP, 1 + W), "bad coefficients");
+    check(m_mu.size == product(NREP, W) && m_dev.size == product(NREP, W), "bad standardization");
+}
+
+void
+ScenarioModel::save(std::ostream & os) const
+{
+    os.write(m_data, m_size);
+}
+
+inline
+num::size_type
+ScenarioModel::bytes(void) const
+{
+    return m_size;
+}
+
+inline
+int
+ScenarioModel::scenario(void) const
+{
+    return m_header[scenario_no];
+}
+
+inline
+unsigned int
+ScenarioModel::seed(void) const
+{
+    return m_header[seed_no];
+}
+
+inline
+num::size_type
+ScenarioModel::columns(void) const
+{
+    return m_header[ncols];
+}
+
+inline
+num::size_type
+ScenarioModel::repetitions(void) const
+{
+    return m_header[nrep];
+}
+
+ImputationPool
+ScenarioModel::imputation_pool(const array_type & X) const
+{
+    assert(X.shape().second == columns());
+
+    return ImputationPool(
+        std::vector<real_type>(m_values.begin(), m_values.end()),
+        std::vector<num::size_type>(m_value_offsets.begin(), m_value_offsets.end()),
+        X);
+}
+
+void
+ScenarioModel::encode(num::size_type rep, array_type & X) const
+{
+    assert(rep < repetitions());
+    assert(X.shape().second == columns());
+
+    const bool binned{static_cast<TargetEncoding>(m_header[encoding_no]) == TargetEncoding::Binned};
+    const num::size_type R{m_remapped.size};
+
+    for (num::size_type k{0}; k < R; ++k)
+    {
+        const num::size_type COLUMN{m_remapped[k]};
+        const num::size_type t{(binned ? 0 : rep) * R + k};
+
+        // straight from the model's arrays, nothing is copied
+        const real_type * keys = m_keys.data + m_key_offsets[t];
+        const real_type * table = m_tables.data + m_table_offsets[t];
+        const num::size_type NVALUES{m_table_offsets[t + 1] - m_table_offsets[t]};
+
+        vector_type mapped_col = X[X.column(COLUMN)];
+
+        if (binned)
+        {
+            assert(m_key_offsets[t + 1] - m_key_offsets[t] == 2);
+
+            num::TargetEncoder<real_type>::transform(keys[0], keys[1], table, NVALUES - 1,
+                std::begin(mapped_col), std::begin(mapped_col), mapped_col.size());
         }
+        else
+        {
+            num::DensityView<real_type>(keys, table, NVALUES).transform(
+                std::begin(mapped_col), std::begin(mapped_col), mapped_col.size());
+        }
+
+        X[X.column(COLUMN)] = mapped_col;
+    }
+}
+
+ScenarioModel::vector_type
+ScenarioModel::score(num::size_type rep, const array_type & X) const
+{
+    assert(rep < repetitions());
+    assert(X.shape().second == columns());
+
+    const num::size_type N{columns()};
+    const num::size_type W{N + m_pairs.size / 2};
+
+    const real_type * theta = m_theta.data + rep * (1 + W);
+    const real_type * mu = m_mu.data + rep * W;
+    const real_type * dev = m_dev.data + rep * W;
+
+    vector_type result(theta[0], X.shape().first);
+
+    // base columns, then their products, standardized as in training
+    for (num::size_type c{0}; c < W; ++c)
+    {
+        const vector_type col = c < N ? vector_type(X[X.column(c)]) :
+            vector_type((vector_type)X[X.column(m_pairs[2 * (c - N)])] *
+                (vector_type)X[X.column(m_pairs[2 * (c - N) + 1])]);
+
+        result += theta[1 + c] * ((col - mu[c]) / dev[c]);
+    }
+
+    return result;
+}
+
+struct ChildStuntedness5
+{
+    enum TestType
+    {
+        Example,
+        Provisional,
+        System
     };
-    const num::loadtxtCfg<real_type>::use_cols_type ts_use_cols[] =
+
+    explicit ChildStuntedness5(const PredictCfg & cfg = PredictCfg())
+    :
+        m_cfg(cfg),
+        m_pool(std::make_shared<num::ThreadPool>(cfg.threads()))
+    {}
+
+    /*
+     * The pool predict runs on, for callers to run their own concurrent
+     * calls to predict on as well, without oversubscribing the machine
+     */
+    num::ThreadPool &
+    pool(void) const
+    {
+        return *m_pool;
+    }
+
+    /*
+     * predict keeps no state between calls, all of its randomness comes
+     * from the configured seed, and the pool may be shared by callers:
+     * concurrent calls from several threads are safe and give the same
+     * results as sequential ones.
+     */
+    std::vector<double>
+    predict(
+        int testType,
+        int scenario,
+        std::vector<std::string> & training,
+        std::vector<std::string> & testing) const;
+
+    std::vector<double>
+    predict(
+        int testType,
+        int scenario,
+        std::vector<std::string> && training,
+        std::vector<std::string> && testing) const;
+
+    /*
+     * predict on subjects already loaded, as returned by take_subjects
+     */
+    std::vector<double>
+    predict(
+        int testType,
+        int scenario,
+        const num::Cohort<real_type> & training,
+        const num::Cohort<real_type> & testing) const;
+
+    /*
+     * Train-once mode: the linear ensemble predict would fit on training,
+     * kept as a ScenarioModel. All NREP repetitions are fitted, on the
+     * materialized design; imputation draws from training values only.
+     */
+    ScenarioModel
+    train(
+        int testType,
+        int scenario,
+        std::vector<std::string> && training) const;
+
+    ScenarioModel
+    train(
+        int testType,
+        int scenario,
+        const num::Cohort<real_type> & training) const;
+
+    /*
+     * Predictions of a trained model for testing subjects, averaged over
+     * its repetitions. Missing testing cells are imputed from the model's
+     * training values, with the seed the model was trained with, so the
+     * result differs from predict's, which draws from both cohorts.
+     */
+    std::vector<double>
+    predict_only(
+        const ScenarioModel & model,
+        std::vector<std::string> && testing) const;
+
+    std::vector<double>
+    predict_only(
+        const ScenarioModel & model,
+        const num::Cohort<real_type> & testing) const;
+
+    /*
+     * All columns of lines, loaded once, so that an evaluation harness
+     * can split them by subject with take_subjects instead of by line.
+     */
+    num::Cohort<real_type>
+    load_table(const std::vector<std::string> & lines) const;
+
+    /*
+     * The given subjects of a load_table table, the way load_data reads
+     * a scenario from their lines: in S1 only their last visit, and
+     * without geniq unless with_target.
+     */
+    static num::Cohort<real_type>
+    take_subjects(
+        int scenario,
+        const num::Cohort<real_type> & table,
+        const std::vector<num::size_type> & subjects,
+        bool with_target);
+
+    static real_type
+    default_C(int scenario);
+
+    /*
+     * Intercept-augmented, standardized training design matrix and target
+     * of a single imputation draw, as fed to the regression in predict.
+     */
+    std::pair<num::array2d<real_type>, std::valarray<real_type>>
+    design(
+        int scenario,
+        std::vector<std::string> && training) const;
+
+    std::pair<num::array2d<real_type>, std::valarray<real_type>>
+    design(
+        int scenario,
+        const num::Cohort<real_type> & training) const;
+
+    /*
+     * Regularization path mode: k-fold CV over training subjects
+     * of the ridge strength, on the design matrices of a single
+     * imputation draw. Each fold's design is imputed, target encoded
+     * and scaled from its training subjects alone, see fold_draw.
+     */
+    num::RegPath<real_type>
+    tune(
+        int scenario,
+        std::vector<std::string> && training,
+        const std::valarray<real_type> & Cs = num::logspace<real_type>(-2, 1, 16),
+        num::size_type nfolds = 5) const;
+
+    num::RegPath<real_type>
+    tune(
+        int scenario,
+        const num::Cohort<real_type> & training,
+        const std::valarray<real_type> & Cs = num::logspace<real_type>(-2, 1, 16),
+        num::size_type nfolds = 5) const;
+
+    /*
+     * Interaction search mode: greedy forward selection (num::select_pairs)
+     * among all pairs of base feature columns, validated on 1/nfolds of
+     * the training subjects, on the design matrices of a single
+     * imputation draw, made from the other subjects alone (fold_draw).
+     */
+    num::PairSelection<real_type>
+    select_pairs(
+        int scenario,
+        std::vector<std::string> && training,
+        num::size_type max_pairs = 30,
+        num::size_type nfolds = 5) const;
+
+    num::PairSelection<real_type>
+    select_pairs(
+        int scenario,
+        const num::Cohort<real_type> & training,
+        num::size_type max_pairs = 30,
+        num::size_type nfolds = 5) const;
+
+private:
+    typedef std::chrono::steady_clock clock_type;
+
+    /*
+     * predict, with PredictCfg::time_budget counted from start
+     */
+    std::vector<double>
+    predict(
+        int testType,
+        int scenario,
+        const num::Cohort<real_type> & training,
+        const num::Cohort<real_type> & testing,
+        clock_type::time_point start) const;
+
+    /*
+     * Imputation repetitions averaged by predict, at most
+     */
+    static num::size_type
+    repetitions(
+        int testType,
+        int scenario);
+
+    // of the input lines
+    enum col
+    {
+        subjid,
+        agedays,
+        wtkg,
+        htcm,
+        lencm,
+        bmi,
+        waz,
+        haz,
+        whz,
+        baz,
+        siteid,
+        sexn,
+        feedingn,
+        gagebrth,
+        birthwt,
+        birthlen,
+        apgar1,
+        apgar5,
+        mage,
+        demo1n,
+        mmaritn,
+        mcignum,
+        parity,
+        gravida,
+        meducyrs,
+        demo2n,
+        geniq
+    };
+
+    /*
+     * Columns of lines read by load_data
+     */
+    static num::CohortCfg<real_type>
+    cohort_cfg(
+        int scenario,
+        bool with_target);
+
+    /*
+     * Training design of the first imputation draw of predict, and target
+     */
+    std::pair<num::array2d<real_type>, std::valarray<real_type>>
+    first_draw(
+        int scenario,
+        const num::Cohort<real_type> & training,
+        DesignOutput output) const;
+
+    /*
+     * Designs of the first imputation draw for a split of the flattened
+     * training data X, y into train_rows and valid_rows. The imputation
+     * pool, target encoding and scaling come from the train rows only,
+     * the valid rows get them as testing data would in predict.
+     */
+    num::FoldData<real_type>
+    fold_draw(
+        int scenario,
+        const num::array2d<real_type> & X,
+        const std::valarray<real_type> & y,
+        const std::vector<num::size_type> & train_rows,
+        const std::vector<num::size_type> & valid_rows,
+        DesignOutput output) const;
+
+    /*
+     * Fitted target encoders with TargetEncoding::Binned, none otherwise
+     */
+    encoders_type
+    make_encoders(
+        const enum ScenarioType scenario,
+        const num::array2d<real_type> & X_tr_data,
+        const std::valarray<real_type> & y_tr_data) const;
+
+    num::Cohort<real_type>
+    load_data(
+        int scenario,
+        std::vector<std::string> && lines,
+        bool with_target) const;
+
+    const PredictCfg m_cfg;
+    const std::shared_ptr<num::ThreadPool> m_pool;
+};
+
+encoders_type
+ChildStuntedness5::make_encoders(
+    const enum ScenarioType scenario,
+    const num::array2d<real_type> & X_tr_data,
+    const std::valarray<real_type> & y_tr_data) const
+{
+    if (m_cfg.encoding() == TargetEncoding::Binned)
+    {
+        return fit_encoders(scenario, X_tr_data, y_tr_data,
+            num::TargetEncoderCfg(m_cfg.encoder()).seed(m_cfg.seed()), *m_pool);
+    }
+    else
+    {
+        return encoders_type();
+    }
+}
+
+num::CohortCfg<real_type>
+ChildStuntedness5::cohort_cfg(
+    int scenario,
+    bool with_target)
+{
+    typedef num::CohortCfg<real_type>::cols_type cols_type;
+
+    auto na_xlt = [](const char * str) -> real_type
+    {
+        return (std::strcmp(str, "NA") == 0) ? NAN : std::strtod(str, nullptr);
+    };
+
+    // measurements, read from every visit row
+    const cols_type visit_cols[] =
+    {
+        {col::subjid, col::agedays},
+        {col::subjid, col::agedays, col::wtkg, col::htcm, col::lencm, col::bmi, col::waz, col::haz, col::whz, col::baz},
+        {col::subjid, col::agedays, col::wtkg, col::htcm, col::lencm, col::bmi, col::waz, col::haz, col::whz, col::baz}
+    };
+    // constant per subject, read from its first visit row only
+    const cols_type subject_cols[] =
     {
         {
-            col::subjid,
             col::sexn,
             col::gagebrth, col::birthwt, col::birthlen, col::apgar1, col::apgar5
         },
         {
-            col::subjid,
-            col::agedays, col::wtkg, col::htcm, col::lencm, col::bmi, col::waz, col::haz, col::whz, col::baz,
             col::sexn,
             col::gagebrth, col::birthwt, col::birthlen, col::apgar1, col::apgar5
         },
         {
-            col::subjid,
-            col::agedays, col::wtkg, col::htcm, col::lencm, col::bmi, col::waz, col::haz, col::whz, col::baz,
             col::siteid,
             col::sexn,
             col::feedingn,
@@ -984,29 +2502,129 @@ ChildStuntedness5::predict(
         }
     };
 
-    array_type i_train_data =
-        num::loadtxt(
-            std::move(i_training),
-            std::move(
-                num::loadtxtCfg<real_type>()
-                .delimiter(',')
-                .converters({{-1, na_xlt}})
-                .use_cols(tr_use_cols[scenario])
-            )
-        );
-    std::cerr << i_train_data.shape() << std::endl;
-
-    array_type i_test_data =
-        num::loadtxt(
-            std::move(i_testing),
-            std::move(
-                num::loadtxtCfg<real_type>()
-                .delimiter(',')
-                .converters({{-1, na_xlt}})
-                .use_cols(ts_use_cols[scenario])
-            )
-        );
-    std::cerr << i_test_data.shape() << std::endl;
+    cols_type use_subject_cols = subject_cols[scenario];
+    if (with_target)
+    {
+        // recorded with the last visit
+        use_subject_cols.push_back(col::geniq);
+    }
+
+    return num::CohortCfg<real_type>()
+        .delimiter(',')
+        .converter(na_xlt)
+        .id_col(col::subjid)
+        .age_col(col::agedays)
+        .visit_cols(visit_cols[scenario])
+        .subject_cols(use_subject_cols)
+        .last_cols({col::geniq});
+}
+
+num::Cohort<real_type>
+ChildStuntedness5::load_data(
+    int scenario,
+    std::vector<std::string> && lines,
+    bool with_target) const
+{
+    num::Cohort<real_type> result = num::load_cohort(lines, cohort_cfg(scenario, with_target), *m_pool);
+    std::cerr << result.visits.shape() << " visits, " << result.subjects.shape() << " subjects" << std::endl;
+
+    return result;
+}
+
+num::Cohort<real_type>
+ChildStuntedness5::load_table(const std::vector<std::string> & lines) const
+{
+    // visit columns are subjid .. baz, subject columns siteid .. geniq
+    num::CohortCfg<real_type>::cols_type visit_cols(col::siteid);
+    num::CohortCfg<real_type>::cols_type subject_cols(col::geniq - col::siteid + 1);
+    std::iota(visit_cols.begin(), visit_cols.end(), num::size_type{col::subjid});
+    std::iota(subject_cols.begin(), subject_cols.end(), num::size_type{col::siteid});
+
+    return num::load_cohort(
+        lines,
+        num::CohortCfg<real_type>(cohort_cfg(ScenarioType::S3, true))
+        .visit_cols(visit_cols)
+        .subject_cols(subject_cols),
+        *m_pool);
+}
+
+num::Cohort<real_type>
+ChildStuntedness5::take_subjects(
+    int scenario,
+    const num::Cohort<real_type> & table,
+    const std::vector<num::size_type> & subjects,
+    bool with_target)
+{
+    const num::CohortCfg<real_type> cfg = cohort_cfg(scenario, with_target);
+
+    // input columns to columns of the load_table tables
+    num::CohortCfg<real_type>::cols_type visit_cols(cfg.visit_cols());
+    num::CohortCfg<real_type>::cols_type subject_cols(cfg.subject_cols());
+    for (auto & c : subject_cols)
+    {
+        c -= col::siteid;
+    }
+
+    return num::gather_cohort(table, subjects, visit_cols, subject_cols, scenario == ScenarioType::S1);
+}
+
+std::vector<double>
+ChildStuntedness5::predict(
+    int testType,
+    int scenario,
+    std::vector<std::string> & training,
+    std::vector<std::string> & testing) const
+{
+    return predict(testType, scenario, std::move(training), std::move(testing));
+}
+
+std::vector<double>
+ChildStuntedness5::predict(
+    int testType,
+    int scenario,
+    std::vector<std::string> && i_training,
+    std::vector<std::string> && i_testing) const
+{
+    assert(scenario <= ScenarioType::S3);
+
+    const clock_type::time_point start = clock_type::now();
+
+    num::Cohort<real_type> train_data{num::zeros<real_type>({0, 0}), num::zeros<real_type>({0, 0}), {}};
+    num::Cohort<real_type> test_data{num::zeros<real_type>({0, 0}), num::zeros<real_type>({0, 0}), {}};
+
+    // both parsed concurrently
+    num::TaskGraph graph;
+    graph.add([&, this]{ train_data = load_data(scenario, std::move(i_training), true); });
+    graph.add([&, this]{ test_data = load_data(scenario, std::move(i_testing), false); });
+    graph.run(*m_pool);
+
+    return predict(testType, scenario, train_data, test_data, start);
+}
+
+std::vector<double>
+ChildStuntedness5::predict(
+    int testType,
+    int scenario,
+    const num::Cohort<real_type> & i_train_data,
+    const num::Cohort<real_type> & i_test_data) const
+{
+    return predict(testType, scenario, i_train_data, i_test_data, clock_type::now());
+}
+
+std::vector<double>
+ChildStuntedness5::predict(
+    int testType,
+    int scenario,
+    const num::Cohort<real_type> & i_train_data,
+    const num::Cohort<real_type> & i_test_data,
+    clock_type::time_point start) const
+{
+    assert(scenario <= ScenarioType::S3);
+
+    std::cerr << "Test: " << testType << " , Scenario: " << scenario << std::endl;
+
+    typedef num::array2d<real_type> array_type;
+    typedef std::valarray<real_type> vector_type;
 
 //    for (int i = 0; i < 35; ++i)
 //    {
@@ -1026,22 +2644,302 @@ ChildStuntedness5::predict(
 //        std::cerr << std::endl;
 //    }
 
-    const vector_type y_tr_data = flatten_y_data(i_train_data, tr_subject_ranges);
     const enum ScenarioType enumerated_scenario = static_cast<enum ScenarioType>(scenario);
-
-    array_type X_tr_data = flatten_X_data(enumerated_scenario, i_train_data, tr_subject_ranges);
-    array_type X_ts_data = flatten_X_data(enumerated_scenario, i_test_data, ts_subject_ranges);
+    const num::VisitGrid<real_type> grid = m_cfg.visit_grid(scenario);
 
 //    auto X_tr_ts_data = repair_X_data(X_tr_data, X_ts_data);
 //    array_type complete_X_tr_data = std::move(X_tr_ts_data.first);
 //    array_type complete_X_ts_data = std::move(X_tr_ts_data.second);
 
-    const real_type C[] =
+    const num::size_type nrep{repetitions(testType, scenario)};
+
+    /*
+     * Repetitions are dealt out in consecutive runs, one task per run,
+     * every run reusing clean columns through its own DesignPipeline.
+     * With Solver::Normal a run also shares one incrementally updated Gram
+     * matrix, whose rounding depends on the run, so there the split is
+     * fixed; otherwise the results do not depend on it.
+     */
+    const num::size_type RUN{m_cfg.solver() == num::Solver::Normal && m_cfg.model() == Model::Linear ?
+        8u : (nrep + m_pool->concurrency() - 1) / m_pool->concurrency()};
+    const num::size_type nruns{(nrep + RUN - 1) / RUN};
+
+    const bool fm{m_cfg.model() == Model::FM};
+    const DesignOutput output{fm ? DesignOutput::Implicit :
+        m_cfg.solver() == num::Solver::Normal ? DesignOutput::Raw :
+        m_cfg.implicit_interactions() ? DesignOutput::Implicit : DesignOutput::Standardized};
+
+    /*
+     * The pipeline as a graph of tasks: flattening of the training target
+     * and of both designs, then the imputation pool and target encoders,
+     * then the runs, and the reduction of their predictions.
+     */
+    vector_type y_tr_data;
+    array_type X_tr_data = num::zeros<real_type>({0, 0});
+    array_type X_ts_data = num::zeros<real_type>({0, 0});
+    std::unique_ptr<const ImputationPool> pool;
+    encoders_type encoders;
+
+    std::vector<vector_type> rep_pred(nrep);
+    std::pair<num::size_type, num::size_type> last_gram_update;
+    vector_type pred;
+
+    /*
+     * With a time budget a repetition is only started if it is expected
+     * to complete by the deadline: as fast as the previous one of its run,
+     * or, for the first one of a run, which has no clean columns to reuse,
+     * as the slowest first one so far. Until one is measured a run rather
+     * waits for a repetition in flight to complete than starts another one
+     * blind, so at most one is ever started without an estimate, and none
+     * once the deadline has passed.
+     */
+    const bool timed{m_cfg.time_budget() > 0};
+    const clock_type::time_point deadline = start +
+        std::chrono::duration_cast<clock_type::duration>(std::chrono::duration<double>(m_cfg.time_budget()));
+    std::mutex cost_mutex;
+    std::condition_variable cost_cv;
+    clock_type::duration first_rep_cost{0};
+    num::size_type unmeasured{0};
+
+    /*
+     * With an ensemble tolerance completed repetitions are folded, in
+     * repetition order, into running per-subject means and variances
+     * (Welford's). Once the Monte Carlo error of the average of the first
+     * n is below the tolerance only those n are used and no later ones
+     * started. Decided on the ordered prefix, the outcome does not depend
+     * on the order repetitions complete in.
+     */
+    constexpr num::size_type MIN_REP{4};
+    const bool adaptive{m_cfg.ensemble_tol() > 0};
+    std::mutex rep_mutex;
+    std::vector<char> rep_done(nrep, false);
+    std::atomic<num::size_type> rep_limit{nrep};
+    num::size_type nfolded{0};
+    vector_type rep_mean;
+    vector_type rep_m2;
+    real_type mc_error{NAN};
+
+    auto fold_done = [&]
     {
-        0.5,
-        .3,
-        .3
+        for (; nfolded < rep_limit && rep_done[nfolded]; ++nfolded)
+        {
+            const vector_type & x = rep_pred[nfolded];
+
+            if (nfolded == 0)
+            {
+                rep_mean.resize(x.size(), 0.0);
+                rep_m2.resize(x.size(), 0.0);
+            }
+
+            const vector_type delta = x - rep_mean;
+            rep_mean += delta / real_type(nfolded + 1);
+            rep_m2 += delta * (x - rep_mean);
+
+            const num::size_type n{nfolded + 1};
+            if (n >= MIN_REP && x.size() != 0)
+            {
+                mc_error = std::sqrt(rep_m2.sum() / ((n - 1) * x.size()) / n);
+
+                if (mc_error < m_cfg.ensemble_tol())
+                {
+                    rep_limit = n;
+                }
+            }
+        }
     };
+
+    num::TaskGraph graph;
+
+    const auto y_task = graph.add([&]{ y_tr_data = flatten_y_data(i_train_data); });
+    const auto X_tr_task = graph.add([&, this]{ X_tr_data = flatten_X_data(i_train_data, grid, *m_pool); });
+    const auto X_ts_task = graph.add([&, this]{ X_ts_data = flatten_X_data(i_test_data, grid, *m_pool); });
+
+    const auto pool_task = graph.add(
+        [&]
+        {
+            pool.reset(new ImputationPool(X_tr_data, X_ts_data));
+            std::cerr << "Missing cells: " << pool->missing() << std::endl;
+        },
+        {X_tr_task, X_ts_task});
+    const auto encoders_task = graph.add(
+        [&, this]{ encoders = make_encoders(enumerated_scenario, X_tr_data, y_tr_data); },
+        {y_task, X_tr_task});
+
+    std::vector<num::TaskGraph::task_id> run_tasks;
+
+    for (num::size_type run{0}; run < nruns; ++run)
+    {
+        run_tasks.push_back(graph.add(
+            [&, this, run]
+            {
+                num::GramCache<real_type> gram(true);
+                DesignPipeline pipeline(enumerated_scenario, m_cfg.pairs(scenario, X_tr_data.shape().second),
+                    X_tr_data, X_ts_data, y_tr_data, *pool,
+                    output,
+                    m_cfg.encoding() == TargetEncoding::Binned ? &encoders : nullptr);
+
+                clock_type::duration rep_cost{0};
+
+                // consecutive repetitions, or strided ones when adaptive,
+                // so that those in flight are about the lowest ones missing
+                const num::size_type first{adaptive ? run : run * RUN};
+                const num::size_type stride{adaptive ? nruns : 1};
+                const num::size_type last{adaptive ? nrep : std::min(nrep, (run + 1) * RUN)};
+
+                for (num::size_type cnt{first}; cnt < last; cnt += stride)
+                {
+                    if (cnt >= rep_limit)
+                    {
+                        break;
+                    }
+
+                    // started without an estimate of its cost
+                    bool blind{false};
+
+                    if (timed)
+                    {
+                        std::unique_lock<std::mutex> lock(cost_mutex);
+
+                        if (cnt != 0)
+                        {
+                            cost_cv.wait_until(lock, deadline,
+                                [&]{ return first_rep_cost.count() != 0 || unmeasured == 0; });
+
+                            const clock_type::duration cost{cnt == first ? first_rep_cost : rep_cost};
+
+                            if (clock_type::now() + cost >= deadline)
+                            {
+                                break;
+                            }
+                        }
+                        if (first_rep_cost.count() == 0)
+                        {
+                            blind = true;
+                            ++unmeasured;
+                        }
+                    }
+
+                    const clock_type::time_point rep_start = clock_type::now();
+
+                    std::mt19937 g = rep_engine(m_cfg.seed(), scenario, cnt);
+
+                    pipeline.draw(g);
+
+                    if (fm)
+                    {
+                        const auto X_std = standardize_X_data(pipeline.train(), pipeline.test());
+
+                        rep_pred[cnt] = do_fm_std(
+                            default_C(scenario),
+                            m_cfg.fm_rank(),
+                            X_std.first,
+                            y_tr_data,
+                            X_std.second,
+                            g());
+                    }
+                    else if (m_cfg.solver() == num::Solver::Normal)
+                    {
+                        rep_pred[cnt] = do_lin_reg_gram(
+                            default_C(scenario),
+                            gram,
+                            pipeline.train(),
+                            y_tr_data,
+                            pipeline.test(),
+                            pipeline.train_cells(),
+                            pipeline.train_cell_offsets());
+
+                        if (cnt == nrep - 1)
+                        {
+                            last_gram_update = {gram.updated_rows(), gram.updated_columns()};
+                        }
+                    }
+                    else if (output == DesignOutput::Implicit)
+                    {
+                        const num::InteractionDesign<real_type> X_train(array_type{pipeline.train()}, pipeline.pairs());
+
+                        rep_pred[cnt] = do_lin_reg_std(
+                            default_C(scenario),
+                            X_train,
+                            y_tr_data,
+                            num::InteractionDesign<real_type>(array_type{pipeline.test()}, X_train),
+                            m_cfg.solver());
+                    }
+                    else
+                    {
+                        rep_pred[cnt] = do_lin_reg_std(
+                            default_C(scenario),
+                            pipeline.std_train(),
+                            y_tr_data,
+                            pipeline.std_test(),
+                            m_cfg.solver());
+                    }
+                    {
+                        std::lock_guard<std::mutex> lock(rep_mutex);
+
+                        rep_done[cnt] = true;
+                        if (adaptive)
+                        {
+                            fold_done();
+                        }
+                    }
+                    std::cerr << ".";
+
+                    rep_cost = clock_type::now() - rep_start;
+                    if (timed && (cnt == first || blind))
+                    {
+                        {
+                            std::lock_guard<std::mutex> lock(cost_mutex);
+
+                            first_rep_cost = std::max(first_rep_cost, rep_cost);
+                            unmeasured -= blind;
+                        }
+                        cost_cv.notify_all();
+                    }
+                }
+            },
+            {y_task, pool_task, encoders_task}));
+    }
+
+    graph.add(
+        [&, this]
+        {
+            std::cerr << std::endl;
+            if (m_cfg.solver() == num::Solver::Normal && !fm)
+            {
+                std::cerr << "Gram update of last repetition: " << last_gram_update.first << " rows, "
+                    << last_gram_update.second << " columns" << std::endl;
+            }
+
+            // combined in repetition order, whatever order they completed in
+            num::size_type ndone{0};
+            pred.resize(X_ts_data.shape().first, 0.0);
+            for (num::size_type cnt{0}; cnt < rep_limit; ++cnt)
+            {
+                if (rep_done[cnt])
+                {
+                    pred += rep_pred[cnt];
+                    ++ndone;
+                }
+            }
+            pred /= ndone;
+
+            std::cerr << "Repetitions: " << ndone << " of " << nrep;
+            if (adaptive)
+            {
+                std::cerr << ", Monte Carlo error: " << mc_error;
+            }
+            std::cerr << std::endl;
+        },
+        run_tasks);
+
+    graph.run(*m_pool);
+
+    return std::vector<double>(std::begin(pred), std::end(pred));
+}
+
+num::size_type
+ChildStuntedness5::repetitions(int testType, int scenario)
+{
     const num::size_type NREP[][3] =
     {
 //        {0, 0, 8},
@@ -1051,32 +2949,376 @@ ChildStuntedness5::predict(
         /* test 3 */ { 64, 24, 16}
     };
 
-    vector_type pred(X_ts_data.shape().first);
+    return NREP[testType][scenario];
+}
 
-    for (num::size_type cnt{}; cnt < NREP[testType][scenario]; ++cnt)
-    {
-        auto X_tr_ts_data = repair_X_data(X_tr_data, X_ts_data);
-        array_type complete_X_tr_data = std::move(X_tr_ts_data.first);
-        array_type complete_X_ts_data = std::move(X_tr_ts_data.second);
+ScenarioModel
+ChildStuntedness5::train(
+    int testType,
+    int scenario,
+    std::vector<std::string> && i_training) const
+{
+    return train(testType, scenario, load_data(scenario, std::move(i_training), true));
+}
+
+ScenarioModel
+ChildStuntedness5::train(
+    int testType,
+    int scenario,
+    const num::Cohort<real_type> & i_train_data) const
+{
+    assert(scenario <= ScenarioType::S3);
+    assert(m_cfg.model() == Model::Linear);
+
+    typedef num::array2d<real_type> array_type;
+    typedef std::valarray<real_type> vector_type;
 
-        X_tr_ts_data = remap_X_data(enumerated_scenario, complete_X_tr_data, complete_X_ts_data, y_tr_data);
-        complete_X_tr_data = std::move(X_tr_ts_data.first);
-        complete_X_ts_data = std::move(X_tr_ts_data.second);
+    const enum ScenarioType enumerated_scenario = static_cast<enum ScenarioType>(scenario);
+    const bool binned{m_cfg.encoding() == TargetEncoding::Binned};
+
+    const vector_type y_tr_data = flatten_y_data(i_train_data);
+    const array_type X_tr_data = flatten_X_data(i_train_data, m_cfg.visit_grid(scenario), *m_pool);
+    const array_type X_ts_data = num::zeros<real_type>({0, X_tr_data.shape().second});
 
-        complete_X_tr_data = preprocess_features(enumerated_scenario, std::move(complete_X_tr_data));
-        complete_X_ts_data = preprocess_features(enumerated_scenario, std::move(complete_X_ts_data));
+    const ImputationPool pool(X_tr_data, X_ts_data);
+    const encoders_type encoders = make_encoders(enumerated_scenario, X_tr_data, y_tr_data);
+    const auto pairs = m_cfg.pairs(scenario, X_tr_data.shape().second);
 
-        pred += do_lin_reg(
-            C[scenario],
-            complete_X_tr_data,
-            y_tr_data,
-            complete_X_ts_data);
-        std::cerr << ".";
+    ScenarioModel::Parts parts;
+
+    parts.scenario = scenario;
+    parts.encoding = m_cfg.encoding();
+    parts.seed = m_cfg.seed();
+    parts.ncols = X_tr_data.shape().second;
+    parts.nrep = repetitions(testType, scenario);
+    for (const auto & pair : pairs)
+    {
+        parts.pairs.push_back(pair.first);
+        parts.pairs.push_back(pair.second);
     }
+    parts.remapped = remap_columns(enumerated_scenario);
+    parts.values = pool.values();
+    parts.value_offsets = pool.value_offsets();
+
+    const num::size_type W{parts.ncols + pairs.size()};
+    const num::size_type R{parts.remapped.size()};
+    const num::size_type NREP{parts.nrep};
+
+    parts.theta.resize(NREP * (1 + W));
+    parts.mu.resize(NREP * W);
+    parts.dev.resize(NREP * W);
+
+    // exact encodings of every repetition, keys and values
+    std::vector<std::pair<std::vector<real_type>, std::vector<real_type>>> densities(binned ? 0 : NREP * R);
+
+    // consecutive repetitions per run, as in predict
+    const num::size_type RUN{(NREP + m_pool->concurrency() - 1) / m_pool->concurrency()};
+    const num::size_type nruns{(NREP + RUN - 1) / RUN};
+
+    m_pool->parallel_for(nruns,
+        [&, this](const num::size_type run)
+        {
+            DesignPipeline pipeline(enumerated_scenario, pairs, X_tr_data, X_ts_data, y_tr_data, pool,
+                DesignOutput::Standardized, binned ? &encoders : nullptr);
+
+            for (num::size_type cnt{run * RUN}; cnt < std::min(NREP, (run + 1) * RUN); ++cnt)
+            {
+                std::mt19937 g = rep_engine(m_cfg.seed(), scenario, cnt);
+
+                pipeline.draw(g);
+
+                const vector_type theta =
+                    fit_lin_reg_std(default_C(scenario), pipeline.std_train(), y_tr_data, m_cfg.solver());
+                std::copy(std::begin(theta), std::end(theta), parts.theta.begin() + cnt * (1 + W));
+
+                // as standardize_column applies them: its centering is
+                // overwritten by the scaling, the columns are only scaled
+                for (num::size_type c{0}; c < W; ++c)
+                {
+                    parts.mu[cnt * W + c] = 0;
+                    parts.dev[cnt * W + c] = num::std<real_type>(pipeline.train()[pipeline.train().column(c)]);
+                }
+
+                for (num::size_type k{0}; k < densities.size() / NREP; ++k)
+                {
+                    const array_type & X_imp = pipeline.imputed_train();
+                    const auto density =
+                        map_feature_y_density(X_imp[X_imp.column(parts.remapped[k])], y_tr_data);
+
+                    densities[cnt * R + k] = {density.keys(), density.values()};
+                }
+
+                std::cerr << ".";
+            }
+        }
+    );
     std::cerr << std::endl;
-    pred /= NREP[testType][scenario];
+
+    parts.key_offsets.push_back(0);
+    parts.table_offsets.push_back(0);
+
+    if (binned)
+    {
+        for (const auto COLUMN : parts.remapped)
+        {
+            const num::TargetEncoder<real_type> & encoder = encoders.at(COLUMN);
+            const std::vector<real_type> table = encoder.table();
+
+            parts.keys.push_back(encoder.lo());
+            parts.keys.push_back(encoder.width());
+            parts.tables.insert(parts.tables.end(), table.cbegin(), table.cend());
+
+            parts.key_offsets.push_back(parts.keys.size());
+            parts.table_offsets.push_back(parts.tables.size());
+        }
+    }
+    else
+    {
+        for (const auto & density : densities)
+        {
+            parts.keys.insert(parts.keys.end(), density.first.cbegin(), density.first.cend());
+            parts.tables.insert(parts.tables.end(), density.second.cbegin(), density.second.cend());
+
+            parts.key_offsets.push_back(parts.keys.size());
+            parts.table_offsets.push_back(parts.tables.size());
+        }
+    }
+
+    return ScenarioModel(parts);
+}
+
+std::vector<double>
+ChildStuntedness5::predict_only(
+    const ScenarioModel & model,
+    std::vector<std::string> && i_testing) const
+{
+    return predict_only(model, load_data(model.scenario(), std::move(i_testing), false));
+}
+
+std::vector<double>
+ChildStuntedness5::predict_only(
+    const ScenarioModel & model,
+    const num::Cohort<real_type> & i_test_data) const
+{
+    typedef num::array2d<real_type> array_type;
+    typedef std::valarray<real_type> vector_type;
+
+    const int scenario{model.scenario()};
+    const num::size_type NREP{model.repetitions()};
+
+    const array_type X_ts_data = flatten_X_data(i_test_data, m_cfg.visit_grid(scenario), *m_pool);
+    assert(X_ts_data.shape().second == model.columns());
+
+    const ImputationPool pool = model.imputation_pool(X_ts_data);
+
+    std::vector<vector_type> rep_pred(NREP);
+
+    m_pool->parallel_for(NREP,
+        [&](const num::size_type cnt)
+        {
+            array_type X_tr = num::zeros<real_type>({0, model.columns()});
+            array_type X_ts = X_ts_data;
+
+            std::mt19937 g = rep_engine(model.seed(), scenario, cnt);
+
+            pool.fill(X_tr, X_ts, g);
+            model.encode(cnt, X_ts);
+            rep_pred[cnt] = model.score(cnt, X_ts);
+        }
+    );
+
+    // combined in repetition order
+    vector_type pred(0.0, X_ts_data.shape().first);
+    for (const auto & p : rep_pred)
+    {
+        pred += p;
+    }
+    pred /= NREP;
 
     return std::vector<double>(std::begin(pred), std::end(pred));
 }
 
+real_type
+ChildStuntedness5::default_C(int scenario)
+{
+    const real_type C[] =
+    {
+        0.5,
+        .3,
+        .3
+    };
+
+    return C[scenario];
+}
+
+std::pair<num::array2d<real_type>, std::valarray<real_type>>
+ChildStuntedness5::design(
+    int scenario,
+    std::vector<std::string> && i_training) const
+{
+    return design(scenario, load_data(scenario, std::move(i_training), true));
+}
+
+std::pair<num::array2d<real_type>, std::valarray<real_type>>
+ChildStuntedness5::design(
+    int scenario,
+    const num::Cohort<real_type> & i_training) const
+{
+    return first_draw(scenario, i_training, DesignOutput::Standardized);
+}
+
+std::pair<num::array2d<real_type>, std::valarray<real_type>>
+ChildStuntedness5::first_draw(
+    int scenario,
+    const num::Cohort<real_type> & i_train_data,
+    DesignOutput output) const
+{
+    assert(scenario <= ScenarioType::S3);
+
+    typedef num::array2d<real_type> array_type;
+
+    std::valarray<real_type> y_tr_data = flatten_y_data(i_train_data);
+    const enum ScenarioType enumerated_scenario = static_cast<enum ScenarioType>(scenario);
+
+    const array_type X_tr_data = flatten_X_data(i_train_data, m_cfg.visit_grid(scenario), *m_pool);
+    // no test subjects, imputation and target encoding see the training cohort only
+    const array_type X_ts_data = num::zeros<real_type>({0, X_tr_data.shape().second});
+    const ImputationPool pool(X_tr_data, X_ts_data);
+    const encoders_type encoders = make_encoders(enumerated_scenario, X_tr_data, y_tr_data);
+
+    DesignPipeline pipeline(enumerated_scenario, m_cfg.pairs(scenario, X_tr_data.shape().second),
+        X_tr_data, X_ts_data, y_tr_data, pool,
+        output, m_cfg.encoding() == TargetEncoding::Binned ? &encoders : nullptr);
+
+    // same draw as the first repetition of predict
+    std::mt19937 g = rep_engine(m_cfg.seed(), scenario, 0);
+    pipeline.draw(g);
+
+    return std::make_pair(
+        output == DesignOutput::Standardized ? pipeline.std_train() : pipeline.train(),
+        std::move(y_tr_data));
+}
+
+num::FoldData<real_type>
+ChildStuntedness5::fold_draw(
+    int scenario,
+    const num::array2d<real_type> & X,
+    const std::valarray<real_type> & y,
+    const std::vector<num::size_type> & train_rows,
+    const std::vector<num::size_type> & valid_rows,
+    DesignOutput output) const
+{
+    assert(scenario <= ScenarioType::S3);
+    assert(output != DesignOutput::Raw);
+
+    typedef num::array2d<real_type> array_type;
+
+    const enum ScenarioType enumerated_scenario = static_cast<enum ScenarioType>(scenario);
+
+    const array_type X_tr_data = num::take_rows(X, train_rows);
+    const array_type X_va_data = num::take_rows(X, valid_rows);
+    std::valarray<real_type> y_tr_data = num::take_rows(y, train_rows);
+
+    const ImputationPool pool(X_tr_data, X_va_data, false);
+    const encoders_type encoders = make_encoders(enumerated_scenario, X_tr_data, y_tr_data);
+
+    DesignPipeline pipeline(enumerated_scenario, m_cfg.pairs(scenario, X.shape().second),
+        X_tr_data, X_va_data, y_tr_data, pool,
+        output, m_cfg.encoding() == TargetEncoding::Binned ? &encoders : nullptr);
+
+    // same draw as the first repetition of predict
+    std::mt19937 g = rep_engine(m_cfg.seed(), scenario, 0);
+    pipeline.draw(g);
+
+    const bool standardized{output == DesignOutput::Standardized};
+
+    return num::FoldData<real_type>{
+        standardized ? pipeline.std_train() : pipeline.train(),
+        std::move(y_tr_data),
+        standardized ? pipeline.std_test() : pipeline.test(),
+        num::take_rows(y, valid_rows)};
+}
+
+num::RegPath<real_type>
+ChildStuntedness5::tune(
+    int scenario,
+    std::vector<std::string> && i_training,
+    const std::valarray<real_type> & Cs,
+    num::size_type nfolds) const
+{
+    return tune(scenario, load_data(scenario, std::move(i_training), true), Cs, nfolds);
+}
+
+num::RegPath<real_type>
+ChildStuntedness5::tune(
+    int scenario,
+    const num::Cohort<real_type> & i_training,
+    const std::valarray<real_type> & Cs,
+    num::size_type nfolds) const
+{
+    std::cerr << "Tune: Scenario: " << scenario << std::endl;
+
+    const std::valarray<real_type> y = flatten_y_data(i_training);
+    const num::array2d<real_type> X = flatten_X_data(i_training, m_cfg.visit_grid(scenario), *m_pool);
+
+    return num::ridge_cv_path(
+        X.shape().first,
+        [&, this](const std::vector<num::size_type> & train_rows, const std::vector<num::size_type> & valid_rows)
+        {
+            return fold_draw(scenario, X, y, train_rows, valid_rows, DesignOutput::Standardized);
+        },
+        Cs, nfolds, 150, 50, m_cfg.seed(), *m_pool, m_cfg.solver());
+}
+
+num::PairSelection<real_type>
+ChildStuntedness5::select_pairs(
+    int scenario,
+    std::vector<std::string> && i_training,
+    num::size_type max_pairs,
+    num::size_type nfolds) const
+{
+    return select_pairs(scenario, load_data(scenario, std::move(i_training), true), max_pairs, nfolds);
+}
+
+num::PairSelection<real_type>
+ChildStuntedness5::select_pairs(
+    int scenario,
+    const num::Cohort<real_type> & i_training,
+    num::size_type max_pairs,
+    num::size_type nfolds) const
+{
+    std::cerr << "Select: Scenario: " << scenario << std::endl;
+
+    const std::valarray<real_type> y = flatten_y_data(i_training);
+    const num::array2d<real_type> X = flatten_X_data(i_training, m_cfg.visit_grid(scenario), *m_pool);
+    const num::size_type NROWS{X.shape().first};
+
+    assert(nfolds > 1 && nfolds <= NROWS);
+
+    // the first fold of ridge_cv_path for validation
+    std::vector<num::size_type> order(NROWS);
+    std::iota(order.begin(), order.end(), 0);
+    std::mt19937 g(m_cfg.seed());
+    std::shuffle(order.begin(), order.end(), g);
+
+    std::vector<num::size_type> train_rows;
+    std::vector<num::size_type> valid_rows;
+
+    for (num::size_type idx{0}; idx < NROWS; ++idx)
+    {
+        (idx % nfolds == 0 ? valid_rows : train_rows).push_back(order[idx]);
+    }
+
+    // split first, the validation rows must not inform their own encoding
+    const num::FoldData<real_type> B_y = fold_draw(scenario, X, y, train_rows, valid_rows, DesignOutput::Implicit);
+
+    return num::select_pairs(
+        B_y.X_train, B_y.y_train,
+        B_y.X_valid, B_y.y_valid,
+        pairwise_perm<num::size_type>(B_y.X_train.shape().second),
+        default_C(scenario),
+        max_pairs,
+        *m_pool);
+}
+
 #endif /* CHILDSTUNTEDNESS5_HPP_ */
@@ -37,6 +37,7 @@
 #include <sstream>
 #include <type_traits>
 #include <unordered_set>
+#include <vector>
 
 namespace num
 {
@@ -53,6 +54,8 @@ typedef std::pair<size_type, size_type> shape_type;
  *   2015-01-30              wm      Class created.
  *   2015-02-22              wm      @c column interface: size_type -> int
  *   2015-02-22              wm      @c at method
+ *   2026-10-19              wm      matrix-matrix @c mul
+ *   2026-10-19              wm      @c data accessor
  *   @endcode
  *******************************************************************************
  *   2d clone of numpy's ndarray:
@@ -78,6 +81,9 @@ public:
 
     shape_type shape(void) const;
 
+    const value_type * data(void) const;
+    value_type * data(void);
+
     value_type at(int p, int q) const;
     value_type & at(int p, int q);
 
@@ -99,6 +105,11 @@ public:
         std::valarray<value_type> & ovector,
         _Op op) const;
 
+    void mul(
+        const Axis,
+        const array2d & imatrix,
+        array2d & omatrix) const;
+
     std::valarray<value_type> operator[](std::slice slicearr) const;
     std::slice_array<value_type> operator[](std::slice slicearr);
     std::valarray<value_type> operator[](const std::gslice & gslicearr) const;
@@ -127,6 +138,22 @@ array2d<_Type>::shape(void) const
     return m_shape;
 }
 
+template<typename _Type>
+inline
+const _Type *
+array2d<_Type>::data(void) const
+{
+    return m_varray.size() ? &m_varray[0] : nullptr;
+}
+
+template<typename _Type>
+inline
+_Type *
+array2d<_Type>::data(void)
+{
+    return m_varray.size() ? &m_varray[0] : nullptr;
+}
+
 template<typename _Type>
 inline
 _Type
@@ -272,6 +299,134 @@ array2d<_Type>::mul(
     }
 }
 
+/*
+ * Matrix-matrix counterpart of the above, without the accumulation op.
+ *
+ * Axis::Row:    omatrix = this * imatrix
+ * Axis::Column: omatrix = this' * imatrix
+ *
+ * For Axis::Row every row of this is reused, from cache, for all columns
+ * of imatrix before moving on to the next one. For Axis::Column rows of
+ * this are walked in blocks, so that the block stays in cache while it is
+ * reused for every column of imatrix. Output columns are produced four
+ * at a time in local accumulators, which keeps them in registers instead
+ * of round-tripping omatrix through memory on every multiply-add.
+ */
+template<typename _Type>
+inline
+void
+array2d<_Type>::mul(
+    const enum Axis axis,
+    const array2d & imatrix,
+    array2d & omatrix) const
+{
+    constexpr size_type BLOCK{64};
+    constexpr size_type WIDTH{4};
+
+    const size_type M{m_shape.first};
+    const size_type N{m_shape.second};
+    const size_type K{imatrix.m_shape.second};
+
+    assert(imatrix.m_shape.first == (axis == Axis::Row ? N : M));
+    assert(omatrix.m_shape == (axis == Axis::Row ? shape_type(M, K) : shape_type(N, K)));
+
+    omatrix.m_varray = value_type{};
+
+    if (M == 0 || N == 0 || K == 0)
+    {
+        return;
+    }
+
+    const value_type * X = &m_varray[0];
+    const value_type * I = &imatrix.m_varray[0];
+    value_type * O = &omatrix.m_varray[0];
+
+    if (axis == Axis::Row)
+    {
+        // O[r, k] = sum_n X[r, n] * I[n, k]
+        for (size_type r{0}; r < M; ++r)
+        {
+            const value_type * Xrow = X + r * N;
+            value_type * Orow = O + r * K;
+            size_type k{0};
+
+            for (; k + WIDTH <= K; k += WIDTH)
+            {
+                value_type acc0{}, acc1{}, acc2{}, acc3{};
+
+                for (size_type n{0}; n < N; ++n)
+                {
+                    const value_type x = Xrow[n];
+                    const value_type * Irow = I + n * K + k;
+
+                    acc0 += x * Irow[0];
+                    acc1 += x * Irow[1];
+                    acc2 += x * Irow[2];
+                    acc3 += x * Irow[3];
+                }
+                Orow[k + 0] = acc0;
+                Orow[k + 1] = acc1;
+                Orow[k + 2] = acc2;
+                Orow[k + 3] = acc3;
+            }
+            for (; k < K; ++k)
+            {
+                value_type acc{};
+
+                for (size_type n{0}; n < N; ++n)
+                {
+                    acc += Xrow[n] * I[n * K + k];
+                }
+                Orow[k] = acc;
+            }
+        }
+    }
+    else
+    {
+        // O[n, k] = sum_r X[r, n] * I[r, k], accumulated block by block of rows
+        for (size_type r0{0}; r0 < M; r0 += BLOCK)
+        {
+            const size_type r1{std::min(M, r0 + BLOCK)};
+
+            for (size_type n{0}; n < N; ++n)
+            {
+                value_type * Orow = O + n * K;
+                size_type k{0};
+
+                for (; k + WIDTH <= K; k += WIDTH)
+                {
+                    value_type acc0{Orow[k + 0]}, acc1{Orow[k + 1]}, acc2{Orow[k + 2]}, acc3{Orow[k + 3]};
+
+                    for (size_type r{r0}; r < r1; ++r)
+                    {
+                        const value_type x = X[r * N + n];
+                        const value_type * Irow = I + r * K + k;
+
+                        acc0 += x * Irow[0];
+                        acc1 += x * Irow[1];
+                        acc2 += x * Irow[2];
+                        acc3 += x * Irow[3];
+                    }
+                    Orow[k + 0] = acc0;
+                    Orow[k + 1] = acc1;
+                    Orow[k + 2] = acc2;
+                    Orow[k + 3] = acc3;
+                }
+                for (; k < K; ++k)
+                {
+                    value_type acc{Orow[k]};
+
+                    for (size_type r{r0}; r < r1; ++r)
+                    {
+                        acc += X[r * N + n] * I[r * K + k];
+                    }
+                    Orow[k] = acc;
+                }
+            }
+        }
+    }
+}
+
 template<typename _Type>
 inline
 std::valarray<_Type>
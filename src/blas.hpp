@@ -0,0 +1,171 @@
+/*******************************************************************************
+ * Copyright (c) 2015 Wojciech Migda
+ * All rights reserved
+ * Distributed under the terms of the GNU LGPL v3
+ *******************************************************************************
+ *
+ * Filename: blas.hpp
+ *
+ * Description:
+ *      Matrix-vector kernels written for the auto-vectorizer
+ *
+ * Authors:
+ *          Wojciech Migda (wm)
+ *
+ *******************************************************************************
+ * History:
+ * --------
+ * Date         Who  Ticket     Description
+ * ----------   ---  ---------  ------------------------------------------------
+ * 2026-10-19   wm              Initial version
+ *
+ ******************************************************************************/
+
+#ifndef BLAS_HPP_
+#define BLAS_HPP_
+
+#include "array2d.hpp"
+#include "num.hpp"
+
+#include <valarray>
+#include <algorithm>
+#include <cassert>
+
+namespace num
+{
+
+/*
+ * Dot product over four interleaved partial sums. The lanes are
+ * independent, so for float/double the loop maps onto SIMD registers
+ * without relying on -ffast-math to reassociate a single running sum.
+ */
+template<typename _ValueType>
+inline
+_ValueType
+dot(const _ValueType * lhs, const _ValueType * rhs, const size_type size)
+{
+    typedef _ValueType value_type;
+
+    value_type acc[4] = {};
+    size_type idx{0};
+
+    for (; idx + 4 <= size; idx += 4)
+    {
+        acc[0] += lhs[idx + 0] * rhs[idx + 0];
+        acc[1] += lhs[idx + 1] * rhs[idx + 1];
+        acc[2] += lhs[idx + 2] * rhs[idx + 2];
+        acc[3] += lhs[idx + 3] * rhs[idx + 3];
+    }
+    for (; idx < size; ++idx)
+    {
+        acc[0] += lhs[idx] * rhs[idx];
+    }
+
+    return (acc[0] + acc[1]) + (acc[2] + acc[3]);
+}
+
+/*
+ * Same contract as array2d::mul without the op:
+ *
+ * Axis::Row:    ovector = X * ivector     (one dot product per row)
+ * Axis::Column: ovector = X' * ivector    (row-blocked, four columns at once)
+ */
+template<typename _ValueType>
+void
+gemv(
+    const typename array2d<_ValueType>::Axis axis,
+    const array2d<_ValueType> & X,
+    const std::valarray<_ValueType> & ivector,
+    std::valarray<_ValueType> & ovector)
+{
+    typedef _ValueType value_type;
+    typedef array2d<value_type> array_type;
+
+    const size_type M{X.shape().first};
+    const size_type N{X.shape().second};
+    const value_type * data = X.data();
+
+    if (axis == array_type::Axis::Row)
+    {
+        assert(ivector.size() == N);
+        assert(ovector.size() == M);
+
+        for (size_type r{0}; r < M; ++r)
+        {
+            ovector[r] = dot(data + r * N, &ivector[0], N);
+        }
+    }
+    else
+    {
+        assert(ivector.size() == M);
+        assert(ovector.size() == N);
+
+        constexpr size_type BLOCK{64};
+
+        ovector = value_type{};
+
+        value_type * out = &ovector[0];
+
+        // blocks of rows, four output columns at a time in registers
+        for (size_type r0{0}; r0 < M; r0 += BLOCK)
+        {
+            const size_type r1{std::min(M, r0 + BLOCK)};
+            size_type c{0};
+
+            for (; c + 4 <= N; c += 4)
+            {
+                value_type acc[4] = {out[c + 0], out[c + 1], out[c + 2], out[c + 3]};
+
+                for (size_type r{r0}; r < r1; ++r)
+                {
+                    const value_type * row = data + r * N + c;
+                    const value_type h = ivector[r];
+
+                    acc[0] += row[0] * h;
+                    acc[1] += row[1] * h;
+                    acc[2] += row[2] * h;
+                    acc[3] += row[3] * h;
+                }
+                out[c + 0] = acc[0];
+                out[c + 1] = acc[1];
+                out[c + 2] = acc[2];
+                out[c + 3] = acc[3];
+            }
+            for (; c < N; ++c)
+            {
+                value_type acc{out[c]};
+
+                for (size_type r{r0}; r < r1; ++r)
+                {
+                    acc += data[r * N + c] * ivector[r];
+                }
+                out[c] = acc;
+            }
+        }
+    }
+}
+
+/*
+ * Squared norm of every column of X, the diagonal of X' * X
+ */
+template<typename _ValueType>
+std::valarray<_ValueType>
+sq_column_norms(const array2d<_ValueType> & X)
+{
+    typedef _ValueType value_type;
+    typedef std::valarray<value_type> vector_type;
+
+    vector_type result(X.shape().second);
+
+    for (size_type c{0}; c < X.shape().second; ++c)
+    {
+        const vector_type col = X[X.column(c)];
+        result[c] = (col * col).sum();
+    }
+
+    return result;
+}
+
+} // namespace num
+
+#endif /* BLAS_HPP_ */
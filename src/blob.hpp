@@ -0,0 +1,339 @@
+/*******************************************************************************
+ * Copyright (c) 2015 Wojciech Migda
+ * All rights reserved
+ * Distributed under the terms of the GNU LGPL v3
+ *******************************************************************************
+ *
+ * Filename: blob.hpp
+ *
+ * Description:
+ *      Flat binary arrays, written once and read in place
+ *
+ * Authors:
+ *          Wojciech Migda (wm)
+ *
+ *******************************************************************************
+ * History:
+ * --------
+ * Date         Who  Ticket     Description
+ * ----------   ---  ---------  ------------------------------------------------
+ * 2026-10-19   wm              Initial version
+ * 2026-10-19   wm              Checked reads of untrusted blobs
+ *
+ ******************************************************************************/
+
+#ifndef BLOB_HPP_
+#define BLOB_HPP_
+
+#include "num.hpp"
+
+#include <vector>
+#include <string>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <cassert>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace num
+{
+
+/*
+ * A blob is a sequence of arrays, each one its element count as
+ * a std::uint64_t followed by its elements. Counts and elements start
+ * at multiples of BLOB_ALIGN bytes, so a blob in memory aligned to
+ * BLOB_ALIGN (heap allocations and mapped files are) is read in place.
+ * Elements are stored in their native representation: a blob is meant
+ * to be read back by the same build which wrote it.
+ */
+constexpr size_type BLOB_ALIGN{alignof(std::max_align_t)};
+
+/**
+ *******************************************************************************
+ *   @brief Appends arrays to a blob
+ *******************************************************************************
+ *   @history @code
+ *   DATE         VERSION    WHO     DESCRIPTION
+ *   -----------  -------    ------  -----------
+ *   2026-10-19              wm      Class created.
+ *   @endcode
+ *******************************************************************************
+ */
+class BlobWriter
+{
+public:
+    template<typename _Type>
+    BlobWriter & put(const _Type * data, size_type size);
+
+    template<typename _Type>
+    BlobWriter & put(const std::vector<_Type> & data);
+
+    std::vector<char> release(void);
+
+private:
+    void append(const void * data, size_type size);
+
+    std::vector<char> m_bytes;
+};
+
+inline
+void
+BlobWriter::append(const void * data, size_type size)
+{
+    const size_type offset{(m_bytes.size() + BLOB_ALIGN - 1) / BLOB_ALIGN * BLOB_ALIGN};
+
+    m_bytes.resize(offset + size, 0);
+    if (size != 0)
+    {
+        std::memcpy(&m_bytes[offset], data, size);
+    }
+}
+
+template<typename _Type>
+BlobWriter &
+BlobWriter::put(const _Type * data, size_type size)
+{
+    static_assert(std::is_trivially_copyable<_Type>::value, "blob elements are copied bytewise");
+    static_assert(alignof(_Type) <= BLOB_ALIGN, "blob elements are aligned to BLOB_ALIGN at most");
+
+    const std::uint64_t count{size};
+
+    append(&count, sizeof (count));
+    append(data, size * sizeof (_Type));
+
+    return *this;
+}
+
+template<typename _Type>
+BlobWriter &
+BlobWriter::put(const std::vector<_Type> & data)
+{
+    return put(data.data(), data.size());
+}
+
+inline
+std::vector<char>
+BlobWriter::release(void)
+{
+    return std::move(m_bytes);
+}
+
+/**
+ *******************************************************************************
+ *   @brief Array of a blob, pointing into it
+ *******************************************************************************
+ *   @history @code
+ *   DATE         VERSION    WHO     DESCRIPTION
+ *   -----------  -------    ------  -----------
+ *   2026-10-19              wm      Class created.
+ *   @endcode
+ *******************************************************************************
+ */
+template<typename _Type>
+struct BlobArray
+{
+    typedef _Type value_type;
+
+    const value_type * data;
+    size_type size;
+
+    const value_type & operator[](size_type idx) const
+    {
+        assert(idx < size);
+        return data[idx];
+    }
+
+    const value_type * begin(void) const
+    {
+        return data;
+    }
+
+    const value_type * end(void) const
+    {
+        return data + size;
+    }
+};
+
+/**
+ *******************************************************************************
+ *   @brief Takes the arrays of a blob in the order they were put
+ *******************************************************************************
+ *   @history @code
+ *   DATE         VERSION    WHO     DESCRIPTION
+ *   -----------  -------    ------  -----------
+ *   2026-10-19              wm      Class created.
+ *   @endcode
+ *******************************************************************************
+ *   Nothing is copied, the arrays point into the blob, which must outlive
+ *   them. The blob may come from a file, so a take reaching past its end
+ *   throws std::runtime_error rather than reading out of bounds.
+ *******************************************************************************
+ */
+class BlobReader
+{
+public:
+    BlobReader(const char * data, size_type size);
+
+    template<typename _Type>
+    BlobArray<_Type> take(void);
+
+    bool done(void) const;
+
+private:
+    const void * skip(size_type size);
+
+    const char * const m_data;
+    const size_type m_size;
+    size_type m_offset;
+};
+
+inline
+BlobReader::BlobReader(const char * data, size_type size)
+:
+    m_data(data),
+    m_size{size},
+    m_offset{0}
+{
+    assert(reinterpret_cast<std::uintptr_t>(data) % BLOB_ALIGN == 0);
+}
+
+inline
+const void *
+BlobReader::skip(size_type size)
+{
+    // m_offset <= m_size always, so neither side can overflow
+    const size_type padding{(BLOB_ALIGN - m_offset % BLOB_ALIGN) % BLOB_ALIGN};
+
+    if (padding > m_size - m_offset || size > m_size - m_offset - padding)
+    {
+        throw std::runtime_error("blob: array of " + std::to_string(size) + " bytes at offset " +
+            std::to_string(m_offset) + " past the end of " + std::to_string(m_size));
+    }
+
+    const size_type offset{m_offset + padding};
+    m_offset = offset + size;
+
+    return m_data + offset;
+}
+
+template<typename _Type>
+BlobArray<_Type>
+BlobReader::take(void)
+{
+    std::uint64_t count;
+    std::memcpy(&count, skip(sizeof (count)), sizeof (count));
+
+    if (count > std::numeric_limits<size_type>::max() / sizeof (_Type))
+    {
+        throw std::runtime_error("blob: array of " + std::to_string(count) + " elements too large");
+    }
+
+    return BlobArray<_Type>{static_cast<const _Type *>(skip(count * sizeof (_Type))), count};
+}
+
+inline
+bool
+BlobReader::done(void) const
+{
+    return m_offset == m_size;
+}
+
+/**
+ *******************************************************************************
+ *   @brief Read-only memory mapping of a whole file
+ *******************************************************************************
+ *   @history @code
+ *   DATE         VERSION    WHO     DESCRIPTION
+ *   -----------  -------    ------  -----------
+ *   2026-10-19              wm      Class created.
+ *   @endcode
+ *******************************************************************************
+ *   Evaluates to false, like a stream, if the file could not be mapped.
+ *******************************************************************************
+ */
+class MappedFile
+{
+public:
+    explicit MappedFile(const std::string & path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile & operator=(const MappedFile &) = delete;
+
+    explicit operator bool(void) const;
+
+    const char * data(void) const;
+    size_type size(void) const;
+
+private:
+    void * m_data;
+    size_type m_size;
+};
+
+inline
+MappedFile::MappedFile(const std::string & path)
+:
+    m_data{nullptr},
+    m_size{0}
+{
+    const int fd = ::open(path.c_str(), O_RDONLY);
+
+    if (fd < 0)
+    {
+        return;
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) == 0 && st.st_size > 0)
+    {
+        void * data = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (data != MAP_FAILED)
+        {
+            m_data = data;
+            m_size = st.st_size;
+        }
+    }
+
+    ::close(fd);
+}
+
+inline
+MappedFile::~MappedFile()
+{
+    if (m_data != nullptr)
+    {
+        ::munmap(m_data, m_size);
+    }
+}
+
+inline
+MappedFile::operator bool(void) const
+{
+    return m_data != nullptr;
+}
+
+inline
+const char *
+MappedFile::data(void) const
+{
+    return static_cast<const char *>(m_data);
+}
+
+inline
+size_type
+MappedFile::size(void) const
+{
+    return m_size;
+}
+
+} // namespace num
+
+#endif /* BLOB_HPP_ */
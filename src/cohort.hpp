@@ -0,0 +1,532 @@
+/*******************************************************************************
+ * Copyright (c) 2015 Wojciech Migda
+ * All rights reserved
+ * Distributed under the terms of the GNU LGPL v3
+ *******************************************************************************
+ *
+ * Filename: cohort.hpp
+ *
+ * Description:
+ *      Longitudinal data split into a subject and a visit table
+ *
+ * Authors:
+ *          Wojciech Migda (wm)
+ *
+ *******************************************************************************
+ * History:
+ * --------
+ * Date         Who  Ticket     Description
+ * ----------   ---  ---------  ------------------------------------------------
+ * 2026-10-19   wm              Initial version
+ * 2026-10-19   wm              Grouping of rows given in any order
+ * 2026-10-19   wm              Subsets of subjects and columns
+ *
+ ******************************************************************************/
+
+#ifndef COHORT_HPP_
+#define COHORT_HPP_
+
+#include "array2d.hpp"
+#include "thread_pool.hpp"
+#include "num.hpp"
+
+#include <valarray>
+#include <vector>
+#include <string>
+#include <utility>
+#include <unordered_map>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cassert>
+
+namespace num
+{
+
+/**
+ *******************************************************************************
+ *   @brief Longitudinal data, per subject and per visit
+ *******************************************************************************
+ *   @history @code
+ *   DATE         VERSION    WHO     DESCRIPTION
+ *   -----------  -------    ------  -----------
+ *   2026-10-19              wm      Class created.
+ *   @endcode
+ *******************************************************************************
+ *   Attributes which do not change between visits are kept once per
+ *   subject. Row s of @c subjects belongs to the visit rows
+ *   [subject_ranges[s].first, subject_ranges[s].second] of @c visits.
+ *******************************************************************************
+ */
+template<typename _Type>
+struct Cohort
+{
+    array2d<_Type> visits;
+    array2d<_Type> subjects;
+    std::vector<std::pair<size_type, size_type>> subject_ranges;
+};
+
+/**
+ *******************************************************************************
+ *   @brief Configuration for @c load_cohort
+ *******************************************************************************
+ *   @history @code
+ *   DATE         VERSION    WHO     DESCRIPTION
+ *   -----------  -------    ------  -----------
+ *   2026-10-19              wm      Class created.
+ *   @endcode
+ *******************************************************************************
+ */
+template<typename _Type = double>
+struct CohortCfg
+{
+    typedef _Type(*converter_type)(const char *);
+    typedef std::vector<size_type> cols_type;
+
+    CohortCfg()
+    :
+        m_delimiter{','},
+        m_converter{nullptr},
+        m_id_col{0},
+        m_age_col{size_type(-1)},
+        m_visit_cols{},
+        m_subject_cols{},
+        m_last_cols{}
+    {}
+
+    char delimiter(void) const
+    {
+        return m_delimiter;
+    }
+
+    CohortCfg & delimiter(char _delimiter)
+    {
+        m_delimiter = _delimiter;
+        return *this;
+    }
+
+    converter_type converter(void) const
+    {
+        return m_converter;
+    }
+
+    /*
+     * Applied to every field read, strtold when not set
+     */
+    CohortCfg & converter(converter_type _converter)
+    {
+        m_converter = _converter;
+        return *this;
+    }
+
+    size_type id_col(void) const
+    {
+        return m_id_col;
+    }
+
+    /*
+     * Integer subject identifier, lines of a subject need not be adjacent
+     */
+    CohortCfg & id_col(size_type _id_col)
+    {
+        m_id_col = _id_col;
+        return *this;
+    }
+
+    size_type age_col(void) const
+    {
+        return m_age_col;
+    }
+
+    /*
+     * Visits of a subject are ordered by this input column, those with
+     * the same (or missing) age keep their input order. Without it, the
+     * default size_type(-1), they keep the input order altogether.
+     */
+    CohortCfg & age_col(size_type _age_col)
+    {
+        m_age_col = _age_col;
+        return *this;
+    }
+
+    const cols_type & visit_cols(void) const
+    {
+        return m_visit_cols;
+    }
+
+    /*
+     * Input columns read from every line, in the order given
+     */
+    CohortCfg & visit_cols(const cols_type & _visit_cols)
+    {
+        m_visit_cols = _visit_cols;
+        return *this;
+    }
+
+    const cols_type & subject_cols(void) const
+    {
+        return m_subject_cols;
+    }
+
+    /*
+     * Input columns read once per subject, from its first line
+     */
+    CohortCfg & subject_cols(const cols_type & _subject_cols)
+    {
+        m_subject_cols = _subject_cols;
+        return *this;
+    }
+
+    const cols_type & last_cols(void) const
+    {
+        return m_last_cols;
+    }
+
+    /*
+     * Those of subject_cols recorded on the last visit only (e.g. an
+     * outcome), read from the last line of the subject instead
+     */
+    CohortCfg & last_cols(const cols_type & _last_cols)
+    {
+        m_last_cols = _last_cols;
+        return *this;
+    }
+
+    char m_delimiter;
+    converter_type m_converter;
+    size_type m_id_col;
+    size_type m_age_col;
+    cols_type m_visit_cols;
+    cols_type m_subject_cols;
+    cols_type m_last_cols;
+};
+
+/**
+ *******************************************************************************
+ *   @brief Input rows grouped by subject, outcome of @c group_subjects
+ *******************************************************************************
+ *   @history @code
+ *   DATE         VERSION    WHO     DESCRIPTION
+ *   -----------  -------    ------  -----------
+ *   2026-10-19              wm      Class created.
+ *   @endcode
+ *******************************************************************************
+ *   Subject s owns the input rows
+ *   order[subject_ranges[s].first] .. order[subject_ranges[s].second].
+ *******************************************************************************
+ */
+struct SubjectGroups
+{
+    std::vector<size_type> order;
+    std::vector<std::pair<size_type, size_type>> subject_ranges;
+};
+
+/*
+ * Group delimited lines, given in any order, by the subject id of
+ * cfg.id_col(). Subjects come in the order of their first appearance,
+ * so already grouped input maps to the identity permutation, and visits
+ * of every subject by cfg.age_col() (if set), stably.
+ *
+ * Ids and ages are parsed concurrently on the pool, rows are bucketed
+ * with a hash of ids and a counting pass, so all but the per subject
+ * sorting of visits, which is concurrent as well, is linear in the
+ * number of rows.
+ */
+template<typename _Type>
+SubjectGroups
+group_subjects(
+    const std::vector<std::string> & lines,
+    const CohortCfg<_Type> & cfg,
+    ThreadPool & pool
+)
+{
+    typedef _Type value_type;
+
+    constexpr size_type BLOCK{4096};
+
+    const size_type NROWS{lines.size()};
+    const bool by_age{cfg.age_col() != size_type(-1)};
+
+    auto convert = [&cfg](const char * str) -> value_type
+    {
+        return cfg.converter() ? cfg.converter()(str) : std::strtold(str, nullptr);
+    };
+
+    std::vector<long int> ids(NROWS);
+    std::vector<value_type> ages(by_age ? NROWS : 0);
+
+    pool.parallel_for((NROWS + BLOCK - 1) / BLOCK,
+        [&](const size_type block)
+        {
+            std::string field;
+
+            for (size_type ridx{block * BLOCK}; ridx < std::min(NROWS, (block + 1) * BLOCK); ++ridx)
+            {
+                const std::string & line = lines[ridx];
+
+                std::string::size_type pos{0};
+                for (size_type col{0}; col < cfg.id_col(); ++col)
+                {
+                    pos = line.find(cfg.delimiter(), pos) + 1;
+                }
+                ids[ridx] = std::strtol(line.c_str() + pos, nullptr, 10);
+
+                if (by_age)
+                {
+                    pos = 0;
+                    for (size_type col{0}; col < cfg.age_col(); ++col)
+                    {
+                        pos = line.find(cfg.delimiter(), pos) + 1;
+                    }
+                    field.assign(line, pos, line.find(cfg.delimiter(), pos) - pos);
+                    ages[ridx] = convert(field.c_str());
+                }
+            }
+        }
+    );
+
+    // subject of every row, numbered by first appearance
+    std::unordered_map<long int, size_type> subject_of;
+    subject_of.reserve(NROWS);
+
+    std::vector<size_type> subject(NROWS);
+    std::vector<size_type> count;
+
+    for (size_type ridx{0}; ridx < NROWS; ++ridx)
+    {
+        const auto found = subject_of.emplace(ids[ridx], subject_of.size());
+
+        if (found.second)
+        {
+            count.push_back(0);
+        }
+        subject[ridx] = found.first->second;
+        ++count[subject[ridx]];
+    }
+
+    const size_type NSUBJ{count.size()};
+
+    SubjectGroups result{std::vector<size_type>(NROWS), std::vector<std::pair<size_type, size_type>>(NSUBJ)};
+
+    std::vector<size_type> next(NSUBJ);
+    for (size_type sidx{0}, first{0}; sidx < NSUBJ; first += count[sidx++])
+    {
+        result.subject_ranges[sidx] = {first, first + count[sidx] - 1};
+        next[sidx] = first;
+    }
+
+    // stable, rows of a subject keep their relative order
+    for (size_type ridx{0}; ridx < NROWS; ++ridx)
+    {
+        result.order[next[subject[ridx]]++] = ridx;
+    }
+
+    if (by_age)
+    {
+        // missing ages go last
+        auto earlier = [&ages](const size_type lhs, const size_type rhs)
+        {
+            return !std::isnan(ages[lhs]) && (std::isnan(ages[rhs]) || ages[lhs] < ages[rhs]);
+        };
+
+        pool.parallel_for((NSUBJ + BLOCK - 1) / BLOCK,
+            [&](const size_type block)
+            {
+                for (size_type sidx{block * BLOCK}; sidx < std::min(NSUBJ, (block + 1) * BLOCK); ++sidx)
+                {
+                    const auto first = result.order.begin() + result.subject_ranges[sidx].first;
+                    const auto last = result.order.begin() + result.subject_ranges[sidx].second + 1;
+
+                    if (!std::is_sorted(first, last, earlier))
+                    {
+                        std::stable_sort(first, last, earlier);
+                    }
+                }
+            }
+        );
+    }
+
+    return result;
+}
+
+/*
+ * Load delimited lines into a Cohort in one pass, in the order of
+ * groups, as found by group_subjects. Fields of columns not configured
+ * are skipped unparsed, so are subject columns on every line but the
+ * first (or last) of a subject.
+ */
+template<typename _Type>
+Cohort<_Type>
+load_cohort(
+    const std::vector<std::string> & lines,
+    const CohortCfg<_Type> & cfg,
+    const SubjectGroups & groups
+)
+{
+    typedef _Type value_type;
+
+    enum Role { None, Visit, Subject, Last };
+
+    const size_type NROWS{groups.order.size()};
+    const size_type NSUBJ{groups.subject_ranges.size()};
+    const size_type NVISIT{cfg.visit_cols().size()};
+    const size_type NSUBJECT{cfg.subject_cols().size()};
+
+    // role of every input column and its slot in the output row
+    size_type NICOLS{0};
+    for (auto col : cfg.visit_cols())
+    {
+        NICOLS = std::max(NICOLS, col + 1);
+    }
+    for (auto col : cfg.subject_cols())
+    {
+        NICOLS = std::max(NICOLS, col + 1);
+    }
+
+    std::vector<Role> role(NICOLS, None);
+    std::vector<size_type> slot(NICOLS, 0);
+
+    for (size_type idx{0}; idx < NVISIT; ++idx)
+    {
+        role[cfg.visit_cols()[idx]] = Visit;
+        slot[cfg.visit_cols()[idx]] = idx;
+    }
+    for (size_type idx{0}; idx < NSUBJECT; ++idx)
+    {
+        const size_type col{cfg.subject_cols()[idx]};
+        const bool last = std::find(cfg.last_cols().cbegin(), cfg.last_cols().cend(), col) != cfg.last_cols().cend();
+
+        assert(role[col] == None);
+        role[col] = last ? Last : Subject;
+        slot[col] = idx;
+    }
+
+    auto convert = [&cfg](const char * str) -> value_type
+    {
+        return cfg.converter() ? cfg.converter()(str) : std::strtold(str, nullptr);
+    };
+
+    Cohort<value_type> result{
+        zeros<value_type>({NROWS, NVISIT}), zeros<value_type>({NSUBJ, NSUBJECT}), groups.subject_ranges};
+
+    std::string field;
+
+    for (size_type sidx{0}; sidx < NSUBJ; ++sidx)
+    {
+        value_type * subject = result.subjects.data() + sidx * NSUBJECT;
+
+        for (size_type ridx{groups.subject_ranges[sidx].first}; ridx <= groups.subject_ranges[sidx].second; ++ridx)
+        {
+            const std::string & line = lines[groups.order[ridx]];
+            const bool first = (ridx == groups.subject_ranges[sidx].first);
+
+            value_type * visit = result.visits.data() + ridx * NVISIT;
+
+            std::string::size_type begin{0};
+            for (size_type col{0}; col < NICOLS && begin <= line.size(); ++col)
+            {
+                std::string::size_type end = line.find(cfg.delimiter(), begin);
+                end = (end == std::string::npos) ? line.size() : end;
+
+                if (role[col] == Visit || role[col] == Last || (role[col] == Subject && first))
+                {
+                    field.assign(line, begin, end - begin);
+
+                    (role[col] == Visit ? visit : subject)[slot[col]] = convert(field.c_str());
+                }
+
+                begin = end + 1;
+            }
+        }
+    }
+
+    return result;
+}
+
+/*
+ * Load delimited lines, in any order, into a Cohort
+ */
+template<typename _Type>
+Cohort<_Type>
+load_cohort(
+    const std::vector<std::string> & lines,
+    const CohortCfg<_Type> & cfg,
+    ThreadPool & pool
+)
+{
+    return load_cohort(lines, cfg, group_subjects(lines, cfg, pool));
+}
+
+/*
+ * The given subjects of cohort, in the order given, with the given
+ * columns of its visit and subject tables. With last_visit_only every
+ * subject keeps its last visit only.
+ */
+template<typename _Type>
+Cohort<_Type>
+gather_cohort(
+    const Cohort<_Type> & cohort,
+    const std::vector<size_type> & subjects,
+    const std::vector<size_type> & visit_cols,
+    const std::vector<size_type> & subject_cols,
+    const bool last_visit_only = false
+)
+{
+    typedef _Type value_type;
+
+    const size_type NSUBJ{subjects.size()};
+    const size_type IN_VISIT{cohort.visits.shape().second};
+    const size_type IN_SUBJECT{cohort.subjects.shape().second};
+    const size_type NVISIT{visit_cols.size()};
+    const size_type NSUBJECT{subject_cols.size()};
+
+    std::vector<std::pair<size_type, size_type>> subject_ranges;
+    subject_ranges.reserve(NSUBJ);
+
+    size_type NROWS{0};
+    for (const auto sidx : subjects)
+    {
+        const auto & range = cohort.subject_ranges[sidx];
+        const size_type count{last_visit_only ? 1 : range.second - range.first + 1};
+
+        subject_ranges.emplace_back(NROWS, NROWS + count - 1);
+        NROWS += count;
+    }
+
+    Cohort<value_type> result{
+        zeros<value_type>({NROWS, NVISIT}), zeros<value_type>({NSUBJ, NSUBJECT}), std::move(subject_ranges)};
+
+    const value_type * in_visits = cohort.visits.data();
+    const value_type * in_subjects = cohort.subjects.data();
+    value_type * out_visits = result.visits.data();
+    value_type * out_subjects = result.subjects.data();
+
+    for (size_type idx{0}; idx < NSUBJ; ++idx)
+    {
+        const auto & range = cohort.subject_ranges[subjects[idx]];
+        const size_type first{last_visit_only ? range.second : range.first};
+
+        for (size_type ridx{first}; ridx <= range.second; ++ridx)
+        {
+            const value_type * irow = in_visits + ridx * IN_VISIT;
+
+            for (size_type col{0}; col < NVISIT; ++col)
+            {
+                *out_visits++ = irow[visit_cols[col]];
+            }
+        }
+
+        const value_type * srow = in_subjects + subjects[idx] * IN_SUBJECT;
+
+        for (size_type col{0}; col < NSUBJECT; ++col)
+        {
+            *out_subjects++ = srow[subject_cols[col]];
+        }
+    }
+
+    return result;
+}
+
+} // namespace num
+
+#endif /* COHORT_HPP_ */
@@ -0,0 +1,283 @@
+/*******************************************************************************
+ * Copyright (c) 2015 Wojciech Migda
+ * All rights reserved
+ * Distributed under the terms of the GNU LGPL v3
+ *******************************************************************************
+ *
+ * Filename: density.hpp
+ *
+ * Description:
+ *      Flat sorted lookup table for target encoding
+ *
+ * Authors:
+ *          Wojciech Migda (wm)
+ *
+ *******************************************************************************
+ * History:
+ * --------
+ * Date         Who  Ticket     Description
+ * ----------   ---  ---------  ------------------------------------------------
+ * 2026-10-19   wm              Initial version
+ * 2026-10-19   wm              Access to keys and values
+ * 2026-10-19   wm              Lookups over arrays held elsewhere
+ *
+ ******************************************************************************/
+
+#ifndef DENSITY_HPP_
+#define DENSITY_HPP_
+
+#include "num.hpp"
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <cassert>
+
+namespace num
+{
+
+/**
+ *******************************************************************************
+ *   @brief DensityTable lookups over keys and values held elsewhere
+ *******************************************************************************
+ *   @history @code
+ *   DATE         VERSION    WHO     DESCRIPTION
+ *   -----------  -------    ------  -----------
+ *   2026-10-19              wm      Class created.
+ *   @endcode
+ *******************************************************************************
+ *   Same lookup as DensityTable, over two arrays it does not own, e.g.
+ *   in a mapped file; they must outlive the view. Cheap to copy.
+ *******************************************************************************
+ */
+template<typename _KeyType, typename _ValueType = _KeyType>
+class DensityView
+{
+public:
+    typedef _KeyType key_type;
+    typedef _ValueType value_type;
+
+    /*
+     * size keys, sorted in strictly ascending order, and as many values
+     */
+    DensityView(const key_type * keys, const value_type * values, size_type size);
+
+    value_type operator()(const key_type & x) const;
+
+    /*
+     * out[i] = (*this)(in[i]) for i in [0, size), in and out may be the same
+     */
+    void transform(const key_type * in, value_type * out, size_type size) const;
+
+    size_type size(void) const;
+
+private:
+    size_type index(const key_type & x) const;
+
+    const key_type * m_keys;
+    const value_type * m_values;
+    size_type m_size;
+};
+
+template<typename _KeyType, typename _ValueType>
+DensityView<_KeyType, _ValueType>::DensityView(
+    const key_type * keys,
+    const value_type * values,
+    size_type size)
+:
+    m_keys(keys),
+    m_values(values),
+    m_size{size}
+{
+    // the order of the keys is left to the caller, a view is made per use
+    assert(m_size != 0);
+}
+
+template<typename _KeyType, typename _ValueType>
+inline
+size_type
+DensityView<_KeyType, _ValueType>::index(const key_type & x) const
+{
+    const key_type * base = m_keys;
+    size_type len{m_size};
+
+    while (len > 1)
+    {
+        const size_type half{len / 2};
+
+        base = (base[half] < x) ? base + half : base;
+        len -= half;
+    }
+
+    // lower bound, past the end maps onto the first key
+    const size_type idx = (base - m_keys) + (*base < x);
+
+    return idx < m_size ? idx : 0;
+}
+
+template<typename _KeyType, typename _ValueType>
+inline
+typename DensityView<_KeyType, _ValueType>::value_type
+DensityView<_KeyType, _ValueType>::operator()(const key_type & x) const
+{
+    return m_values[index(x)];
+}
+
+template<typename _KeyType, typename _ValueType>
+void
+DensityView<_KeyType, _ValueType>::transform(
+    const key_type * in,
+    value_type * out,
+    size_type size) const
+{
+    constexpr size_type LANES{4};
+
+    size_type idx{0};
+
+    // independent searches side by side, so their loads overlap
+    for (; idx + LANES <= size; idx += LANES)
+    {
+        size_type found[LANES];
+
+        for (size_type lane{0}; lane < LANES; ++lane)
+        {
+            found[lane] = index(in[idx + lane]);
+        }
+        for (size_type lane{0}; lane < LANES; ++lane)
+        {
+            out[idx + lane] = m_values[found[lane]];
+        }
+    }
+    for (; idx < size; ++idx)
+    {
+        out[idx] = m_values[index(in[idx])];
+    }
+}
+
+template<typename _KeyType, typename _ValueType>
+inline
+size_type
+DensityView<_KeyType, _ValueType>::size(void) const
+{
+    return m_size;
+}
+
+/**
+ *******************************************************************************
+ *   @brief Values attached to sorted keys, looked up by the next key up
+ *******************************************************************************
+ *   @history @code
+ *   DATE         VERSION    WHO     DESCRIPTION
+ *   -----------  -------    ------  -----------
+ *   2026-10-19              wm      Class created.
+ *   @endcode
+ *******************************************************************************
+ *   Keys and values are kept in two contiguous arrays. A lookup of x
+ *   returns the value of the smallest key not less than x, that is of x
+ *   itself when it is a key; past the largest key it falls back to the
+ *   value of the smallest one.
+ *
+ *   The search is a branchless lower bound with a fixed number of steps
+ *   for a given table size, so that batch lookups pipeline well. It is
+ *   done by a DensityView of the table's own arrays.
+ *******************************************************************************
+ */
+template<typename _KeyType, typename _ValueType = _KeyType>
+class DensityTable
+{
+public:
+    typedef _KeyType key_type;
+    typedef _ValueType value_type;
+
+    /*
+     * keys must be sorted in strictly ascending order
+     */
+    DensityTable(std::vector<key_type> && keys, std::vector<value_type> && values);
+
+    value_type operator()(const key_type & x) const;
+
+    /*
+     * out[i] = (*this)(in[i]) for i in [0, size), in and out may be the same
+     */
+    void transform(const key_type * in, value_type * out, size_type size) const;
+
+    size_type size(void) const;
+
+    // the arrays the table was built from, e.g. to save it
+    const std::vector<key_type> & keys(void) const;
+    const std::vector<value_type> & values(void) const;
+
+private:
+    DensityView<key_type, value_type> view(void) const;
+
+    std::vector<key_type> m_keys;
+    std::vector<value_type> m_values;
+};
+
+template<typename _KeyType, typename _ValueType>
+DensityTable<_KeyType, _ValueType>::DensityTable(
+    std::vector<key_type> && keys,
+    std::vector<value_type> && values)
+:
+    m_keys(std::move(keys)),
+    m_values(std::move(values))
+{
+    assert(m_keys.size() == m_values.size());
+    assert(!m_keys.empty());
+    assert(std::adjacent_find(m_keys.cbegin(), m_keys.cend(),
+        [](const key_type & lhs, const key_type & rhs){ return !(lhs < rhs); }) == m_keys.cend());
+}
+
+template<typename _KeyType, typename _ValueType>
+inline
+DensityView<_KeyType, _ValueType>
+DensityTable<_KeyType, _ValueType>::view(void) const
+{
+    return DensityView<key_type, value_type>(m_keys.data(), m_values.data(), m_keys.size());
+}
+template<typename _KeyType, typename _ValueType>
+inline
+typename DensityTable<_KeyType, _ValueType>::value_type
+DensityTable<_KeyType, _ValueType>::operator()(const key_type & x) const
+{
+    return view()(x);
+}
+
+template<typename _KeyType, typename _ValueType>
+inline
+void
+DensityTable<_KeyType, _ValueType>::transform(
+    const key_type * in,
+    value_type * out,
+    size_type size) const
+{
+    view().transform(in, out, size);
+}
+
+template<typename _KeyType, typename _ValueType>
+inline
+size_type
+DensityTable<_KeyType, _ValueType>::size(void) const
+{
+    return m_keys.size();
+}
+
+template<typename _KeyType, typename _ValueType>
+inline
+const std::vector<typename DensityTable<_KeyType, _ValueType>::key_type> &
+DensityTable<_KeyType, _ValueType>::keys(void) const
+{
+    return m_keys;
+}
+
+template<typename _KeyType, typename _ValueType>
+inline
+const std::vector<typename DensityTable<_KeyType, _ValueType>::value_type> &
+DensityTable<_KeyType, _ValueType>::values(void) const
+{
+    return m_values;
+}
+
+} // namespace num
+
+#endif /* DENSITY_HPP_ */
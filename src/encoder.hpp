@@ -0,0 +1,403 @@
+/*******************************************************************************
+ * Copyright (c) 2015 Wojciech Migda
+ * All rights reserved
+ * Distributed under the terms of the GNU LGPL v3
+ *******************************************************************************
+ *
+ * Filename: encoder.hpp
+ *
+ * Description:
+ *      Histogram-binned, out-of-fold target encoder
+ *
+ * Authors:
+ *          Wojciech Migda (wm)
+ *
+ *******************************************************************************
+ * History:
+ * --------
+ * Date         Who  Ticket     Description
+ * ----------   ---  ---------  ------------------------------------------------
+ * 2026-10-19   wm              Initial version
+ * 2026-10-19   wm              Transform by a table kept elsewhere
+ *
+ ******************************************************************************/
+
+#ifndef ENCODER_HPP_
+#define ENCODER_HPP_
+
+#include "thread_pool.hpp"
+#include "num.hpp"
+
+#include <valarray>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <numeric>
+#include <limits>
+#include <cmath>
+#include <cassert>
+
+namespace num
+{
+
+/**
+ *******************************************************************************
+ *   @brief Configuration for @c TargetEncoder
+ *******************************************************************************
+ *   @history @code
+ *   DATE         VERSION    WHO     DESCRIPTION
+ *   -----------  -------    ------  -----------
+ *   2026-10-19              wm      Class created.
+ *   @endcode
+ *******************************************************************************
+ */
+struct TargetEncoderCfg
+{
+    TargetEncoderCfg()
+    :
+        m_nbins{32},
+        m_smoothing{10.0},
+        m_nfolds{5},
+        m_seed{0}
+    {}
+
+    size_type nbins(void) const
+    {
+        return m_nbins;
+    }
+
+    /*
+     * Number of equal-width bins spanning the observed training range
+     */
+    TargetEncoderCfg & nbins(size_type _nbins)
+    {
+        m_nbins = _nbins;
+        return *this;
+    }
+
+    double smoothing(void) const
+    {
+        return m_smoothing;
+    }
+
+    /*
+     * Weight, in rows, of the prior (overall target mean) blended into
+     * every bin mean; sparsely populated bins shrink towards the prior
+     */
+    TargetEncoderCfg & smoothing(double _smoothing)
+    {
+        m_smoothing = _smoothing;
+        return *this;
+    }
+
+    size_type nfolds(void) const
+    {
+        return m_nfolds;
+    }
+
+    /*
+     * Training rows are encoded with tables fitted on the other folds only
+     */
+    TargetEncoderCfg & nfolds(size_type _nfolds)
+    {
+        m_nfolds = _nfolds;
+        return *this;
+    }
+
+    unsigned int seed(void) const
+    {
+        return m_seed;
+    }
+
+    TargetEncoderCfg & seed(unsigned int _seed)
+    {
+        m_seed = _seed;
+        return *this;
+    }
+
+    size_type m_nbins;
+    double m_smoothing;
+    size_type m_nfolds;
+    unsigned int m_seed;
+};
+
+/**
+ *******************************************************************************
+ *   @brief Replaces feature values with the smoothed mean target of their bin
+ *******************************************************************************
+ *   @history @code
+ *   DATE         VERSION    WHO     DESCRIPTION
+ *   -----------  -------    ------  -----------
+ *   2026-10-19              wm      Class created.
+ *   @endcode
+ *******************************************************************************
+ *   Fitted once, applied many times. @c fit bins the observed (non-NaN)
+ *   training values into a fixed histogram. It keeps one table of
+ *   smoothed per-bin target means fitted on all training rows, and one
+ *   per fold fitted on the remaining folds, the latter computed
+ *   concurrently.
+ *
+ *   @c transform_train encodes the training rows out-of-fold, so a row's
+ *   own target never leaks into its encoding; @c transform encodes any
+ *   other data with the full table. Either is a single table lookup per
+ *   value. NaNs, and bins never seen in training, encode as the prior.
+ *******************************************************************************
+ */
+template<typename _ValueType>
+class TargetEncoder
+{
+public:
+    typedef _ValueType value_type;
+    typedef std::valarray<value_type> vector_type;
+
+    explicit TargetEncoder(const TargetEncoderCfg & cfg = TargetEncoderCfg());
+
+    /*
+     * x holds the training values of the feature, NaN where not observed
+     */
+    TargetEncoder & fit(const vector_type & x, const vector_type & y, ThreadPool & pool);
+
+    /*
+     * Out-of-fold encoding of the rows fit was given, in the same order
+     */
+    void transform_train(const value_type * x, value_type * out, size_type size) const;
+
+    /*
+     * Encoding of any other data, by the table fitted on all rows
+     */
+    void transform(const value_type * x, value_type * out, size_type size) const;
+
+    /*
+     * transform by the lo, width and table of a fitted encoder, kept elsewhere
+     */
+    static void transform(value_type lo, value_type width, const value_type * table, size_type nbins,
+        const value_type * x, value_type * out, size_type size);
+
+    size_type bin(value_type x) const;
+    static size_type bin(value_type x, value_type lo, value_type width, size_type nbins);
+
+    // lower edge and width of the bins
+    value_type lo(void) const;
+    value_type width(void) const;
+
+    // the table transform encodes with, nbins means and the prior
+    std::vector<value_type> table(void) const;
+
+private:
+    const TargetEncoderCfg m_cfg;
+
+    value_type m_lo;
+    value_type m_width;
+
+    // nbins means and the prior last, the first table is fitted on all rows
+    // and every subsequent one without the matching fold
+    std::vector<value_type> m_tables;
+    std::vector<size_type> m_fold;
+};
+
+template<typename _ValueType>
+TargetEncoder<_ValueType>::TargetEncoder(const TargetEncoderCfg & cfg)
+:
+    m_cfg(cfg),
+    m_lo{0},
+    m_width{1},
+    m_tables{},
+    m_fold{}
+{
+    assert(cfg.nbins() > 0);
+    assert(cfg.nfolds() > 1);
+}
+
+template<typename _ValueType>
+inline
+typename TargetEncoder<_ValueType>::value_type
+TargetEncoder<_ValueType>::lo(void) const
+{
+    return m_lo;
+}
+
+template<typename _ValueType>
+inline
+typename TargetEncoder<_ValueType>::value_type
+TargetEncoder<_ValueType>::width(void) const
+{
+    return m_width;
+}
+
+template<typename _ValueType>
+std::vector<typename TargetEncoder<_ValueType>::value_type>
+TargetEncoder<_ValueType>::table(void) const
+{
+    assert(m_tables.size() >= m_cfg.nbins() + 1);
+
+    return std::vector<value_type>(m_tables.cbegin(), m_tables.cbegin() + m_cfg.nbins() + 1);
+}
+
+template<typename _ValueType>
+inline
+size_type
+TargetEncoder<_ValueType>::bin(value_type x) const
+{
+    return bin(x, m_lo, m_width, m_cfg.nbins());
+}
+
+template<typename _ValueType>
+inline
+size_type
+TargetEncoder<_ValueType>::bin(value_type x, value_type lo, value_type width, size_type nbins)
+{
+    if (std::isnan(x))
+    {
+        return nbins;
+    }
+
+    const value_type t = (x - lo) / width;
+
+    return t < 0 ? 0 : (t >= nbins ? nbins - 1 : static_cast<size_type>(t));
+}
+
+template<typename _ValueType>
+TargetEncoder<_ValueType> &
+TargetEncoder<_ValueType>::fit(const vector_type & x, const vector_type & y, ThreadPool & pool)
+{
+    assert(x.size() == y.size());
+
+    const size_type NBINS{m_cfg.nbins()};
+    const size_type NFOLDS{m_cfg.nfolds()};
+    const size_type NROWS{x.size()};
+    const value_type m = m_cfg.smoothing();
+
+    value_type lo = std::numeric_limits<value_type>::infinity();
+    value_type hi = -std::numeric_limits<value_type>::infinity();
+    for (size_type r{0}; r < NROWS; ++r)
+    {
+        if (!std::isnan(x[r]))
+        {
+            lo = std::min(lo, x[r]);
+            hi = std::max(hi, x[r]);
+        }
+    }
+    m_lo = lo <= hi ? lo : 0;
+    m_width = lo < hi ? (hi - lo) / NBINS : 1;
+
+    // rows shuffled into folds
+    std::vector<size_type> order(NROWS);
+    std::iota(order.begin(), order.end(), 0);
+    std::mt19937 g(m_cfg.seed());
+    std::shuffle(order.begin(), order.end(), g);
+
+    m_fold.assign(NROWS, 0);
+    for (size_type idx{0}; idx < NROWS; ++idx)
+    {
+        m_fold[order[idx]] = idx % NFOLDS;
+    }
+
+    // per fold histograms of target sums and counts, the extra bin is the whole fold
+    std::vector<value_type> sums((NBINS + 1) * NFOLDS, 0);
+    std::vector<size_type> counts((NBINS + 1) * NFOLDS, 0);
+
+    pool.parallel_for(NFOLDS,
+        [this, &x, &y, &sums, &counts, NBINS, NROWS](const size_type fold)
+        {
+            value_type * fsums = &sums[fold * (NBINS + 1)];
+            size_type * fcounts = &counts[fold * (NBINS + 1)];
+
+            for (size_type r{0}; r < NROWS; ++r)
+            {
+                if (m_fold[r] == fold && !std::isnan(x[r]))
+                {
+                    const size_type b = bin(x[r]);
+
+                    fsums[b] += y[r];
+                    ++fcounts[b];
+                    fsums[NBINS] += y[r];
+                    ++fcounts[NBINS];
+                }
+            }
+        }
+    );
+
+    std::vector<value_type> total_sums(NBINS + 1, 0);
+    std::vector<size_type> total_counts(NBINS + 1, 0);
+    for (size_type fold{0}; fold < NFOLDS; ++fold)
+    {
+        for (size_type b{0}; b <= NBINS; ++b)
+        {
+            total_sums[b] += sums[fold * (NBINS + 1) + b];
+            total_counts[b] += counts[fold * (NBINS + 1) + b];
+        }
+    }
+
+    m_tables.assign((NBINS + 1) * (NFOLDS + 1), 0);
+
+    // table 0 from all rows, table 1 + f from all but fold f
+    for (size_type table{0}; table <= NFOLDS; ++table)
+    {
+        auto bin_sum = [&](size_type b) -> value_type
+        {
+            return total_sums[b] - (table == 0 ? 0 : sums[(table - 1) * (NBINS + 1) + b]);
+        };
+        auto bin_count = [&](size_type b) -> size_type
+        {
+            return total_counts[b] - (table == 0 ? 0 : counts[(table - 1) * (NBINS + 1) + b]);
+        };
+
+        value_type * out = &m_tables[table * (NBINS + 1)];
+        const value_type prior = bin_count(NBINS) != 0 ? bin_sum(NBINS) / bin_count(NBINS) : value_type{};
+
+        for (size_type b{0}; b < NBINS; ++b)
+        {
+            out[b] = bin_count(b) + m > 0 ? (bin_sum(b) + m * prior) / (bin_count(b) + m) : prior;
+        }
+        out[NBINS] = prior;
+    }
+
+    return *this;
+}
+
+template<typename _ValueType>
+void
+TargetEncoder<_ValueType>::transform_train(const value_type * x, value_type * out, size_type size) const
+{
+    assert(size == m_fold.size());
+
+    const size_type NBINS{m_cfg.nbins()};
+
+    for (size_type r{0}; r < size; ++r)
+    {
+        out[r] = m_tables[(1 + m_fold[r]) * (NBINS + 1) + bin(x[r])];
+    }
+}
+
+template<typename _ValueType>
+void
+TargetEncoder<_ValueType>::transform(const value_type * x, value_type * out, size_type size) const
+{
+    for (size_type r{0}; r < size; ++r)
+    {
+        out[r] = m_tables[bin(x[r])];
+    }
+}
+
+template<typename _ValueType>
+void
+TargetEncoder<_ValueType>::transform(
+    value_type lo,
+    value_type width,
+    const value_type * table,
+    size_type nbins,
+    const value_type * x,
+    value_type * out,
+    size_type size)
+{
+    assert(nbins > 0);
+
+    for (size_type r{0}; r < size; ++r)
+    {
+        out[r] = table[bin(x[r], lo, width, nbins)];
+    }
+}
+
+} // namespace num
+
+#endif /* ENCODER_HPP_ */
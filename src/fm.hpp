@@ -0,0 +1,345 @@
+/*******************************************************************************
+ * Copyright (c) 2015 Wojciech Migda
+ * All rights reserved
+ * Distributed under the terms of the GNU LGPL v3
+ *******************************************************************************
+ *
+ * Filename: fm.hpp
+ *
+ * Description:
+ *      Second-order factorization machine
+ *
+ * Authors:
+ *          Wojciech Migda (wm)
+ *
+ *******************************************************************************
+ * History:
+ * --------
+ * Date         Who  Ticket     Description
+ * ----------   ---  ---------  ------------------------------------------------
+ * 2026-10-19   wm              Initial version
+ *
+ ******************************************************************************/
+
+#ifndef FM_HPP_
+#define FM_HPP_
+
+#include "array2d.hpp"
+#include "fmincg.hpp"
+#include "num.hpp"
+
+#include <valarray>
+#include <utility>
+#include <random>
+#include <functional>
+#include <cassert>
+
+namespace num
+{
+
+/*
+ * Parameters of a factorization machine over an N column design are
+ * packed into one vector: theta (N), the linear weights as in
+ * LinearRegression, followed by V ((N - 1) x rank, row-major), the
+ * latent factors of columns 1 .. N - 1. Column 0 is the intercept
+ * and has no factors.
+ *
+ *   y = X * theta + 1/2 * sum_f ((sum_i V_if x_i)^2 - sum_i V_if^2 x_i^2)
+ *
+ * which is the sum over all pairs i < j of <V_i, V_j> x_i x_j,
+ * evaluated in O(N * rank) per row.
+ */
+inline
+size_type
+fm_size(const size_type N, const size_type rank)
+{
+    return N + (N - 1) * rank;
+}
+
+/*
+ * Predictions for all rows of X, into out
+ */
+template<typename _ValueType>
+void
+fm_predict(
+    /// out
+    std::valarray<_ValueType> & out,
+    std::valarray<_ValueType> & tsum,
+    /// in
+    const std::valarray<_ValueType> & params,
+    const array2d<_ValueType> & X,
+    const size_type rank
+)
+{
+    typedef _ValueType value_type;
+
+    const size_type M{X.shape().first};
+    const size_type N{X.shape().second};
+
+    assert(params.size() == fm_size(N, rank));
+    assert(out.size() == M);
+    assert(tsum.size() >= rank);
+
+    const value_type * theta = &params[0];
+    const value_type * V = &params[N];
+    const value_type * data = X.data();
+
+    for (size_type r{0}; r < M; ++r)
+    {
+        const value_type * row = data + r * N;
+
+        value_type linear{0};
+        for (size_type i{0}; i < N; ++i)
+        {
+            linear += theta[i] * row[i];
+        }
+
+        // s_f = sum_i V_if x_i, pairwise = 1/2 * sum_f (s_f^2 - sum_i (V_if x_i)^2)
+        value_type pairwise{0};
+        for (size_type f{0}; f < rank; ++f)
+        {
+            tsum[f] = 0;
+        }
+        for (size_type i{1}; i < N; ++i)
+        {
+            const value_type * Vi = V + (i - 1) * rank;
+
+            for (size_type f{0}; f < rank; ++f)
+            {
+                const value_type vx = Vi[f] * row[i];
+
+                tsum[f] += vx;
+                pairwise -= vx * vx;
+            }
+        }
+        for (size_type f{0}; f < rank; ++f)
+        {
+            pairwise += tsum[f] * tsum[f];
+        }
+
+        out[r] = linear + pairwise / 2;
+    }
+}
+
+/*
+ * Cost and gradient of the ridge-regularized squared error, the
+ * factorization machine counterpart of linreg_cost_grad: everything
+ * but theta[0] is penalized with 1 / C.
+ */
+template<typename _ValueType>
+void
+fm_cost_grad(
+    /// out
+    _ValueType & out_cost,
+    std::valarray<_ValueType> & out_grad,
+    std::valarray<_ValueType> & tcol,
+    std::valarray<_ValueType> & tsum,
+    /// in
+    const std::valarray<_ValueType> & params,
+    const array2d<_ValueType> & X,
+    const std::valarray<_ValueType> & y,
+    const _ValueType C,
+    const size_type rank
+)
+{
+    typedef _ValueType value_type;
+    typedef std::valarray<value_type> vector_type;
+
+    const size_type M{X.shape().first};
+    const size_type N{X.shape().second};
+
+    assert(y.size() == M);
+    assert(out_grad.size() == params.size());
+    assert(tcol.size() >= M);
+
+    vector_type & H = tcol;
+
+    fm_predict(H, tsum, params, X, rank);
+    H -= y;
+
+    out_cost = ((H * H).sum() + ((params * params).sum() - params[0] * params[0]) / C) / (2.0 * M);
+
+    out_grad = params / C;
+    out_grad[0] = 0.0;
+
+    const value_type * V = &params[N];
+    value_type * grad_theta = &out_grad[0];
+    value_type * grad_V = &out_grad[N];
+    const value_type * data = X.data();
+
+    for (size_type r{0}; r < M; ++r)
+    {
+        const value_type * row = data + r * N;
+        const value_type h = H[r];
+
+        for (size_type i{0}; i < N; ++i)
+        {
+            grad_theta[i] += h * row[i];
+        }
+
+        for (size_type f{0}; f < rank; ++f)
+        {
+            tsum[f] = 0;
+        }
+        for (size_type i{1}; i < N; ++i)
+        {
+            const value_type * Vi = V + (i - 1) * rank;
+
+            for (size_type f{0}; f < rank; ++f)
+            {
+                tsum[f] += Vi[f] * row[i];
+            }
+        }
+
+        // d y / d V_if = x_i * (s_f - V_if x_i)
+        for (size_type i{1}; i < N; ++i)
+        {
+            const value_type * Vi = V + (i - 1) * rank;
+            value_type * grad_Vi = grad_V + (i - 1) * rank;
+            const value_type hx = h * row[i];
+
+            for (size_type f{0}; f < rank; ++f)
+            {
+                grad_Vi[f] += hx * (tsum[f] - Vi[f] * row[i]);
+            }
+        }
+    }
+
+    out_grad /= M;
+}
+
+/**
+ *******************************************************************************
+ *   @brief Second-order factorization machine regressor
+ *******************************************************************************
+ *   @history @code
+ *   DATE         VERSION    WHO     DESCRIPTION
+ *   -----------  -------    ------  -----------
+ *   2026-10-19              wm      Class created.
+ *   @endcode
+ *******************************************************************************
+ *   Counterpart of @c LinearRegression which models all pairwise
+ *   interactions of the design columns through rank-k latent factors,
+ *   instead of through product columns appended to the design. Memory
+ *   and the cost of a cost/gradient evaluation stay O(M * N * k).
+ *
+ *   X is expected the way LinearRegression takes it, intercept column
+ *   first and standardized. Fitted with fmincg, from zero linear
+ *   weights and small random factors drawn from seed (all-zero factors
+ *   would be a stationary point).
+ *******************************************************************************
+ */
+template<typename _ValueType>
+class FactorizationMachine
+{
+public:
+    typedef _ValueType value_type;
+    typedef std::valarray<value_type> vector_type;
+    typedef array2d<value_type> array_type;
+
+    FactorizationMachine(
+        array_type && X,
+        vector_type && y,
+        value_type C,
+        size_type rank,
+        size_type max_iter,
+        unsigned int seed = 0
+    );
+
+    /*
+     * Packed parameters, as described at fm_size
+     */
+    vector_type
+    fit(void) const;
+
+    vector_type
+    predict(const array_type & X, const vector_type & params) const;
+
+    vector_type
+    predict(array_type && X, vector_type && params) const;
+
+private:
+    const array_type m_X;
+    const vector_type m_y;
+    const value_type m_C;
+    const size_type m_rank;
+    const size_type m_max_iter;
+    const unsigned int m_seed;
+};
+
+template<typename _ValueType>
+FactorizationMachine<_ValueType>::FactorizationMachine(
+    array_type && X,
+    vector_type && y,
+    value_type C,
+    size_type rank,
+    size_type max_iter,
+    unsigned int seed
+)
+:
+    m_X{std::move(X)},
+    m_y{std::move(y)},
+    m_C{C},
+    m_rank{rank},
+    m_max_iter{max_iter},
+    m_seed{seed}
+{
+    assert(m_X.shape().second > 0);
+    assert(m_rank > 0);
+}
+
+template<typename _ValueType>
+typename FactorizationMachine<_ValueType>::vector_type
+FactorizationMachine<_ValueType>::fit(void) const
+{
+    const size_type N{m_X.shape().second};
+
+    vector_type params0(0.0, fm_size(N, m_rank));
+
+    std::mt19937 g(m_seed);
+    std::normal_distribution<double> factor(0.0, 0.01);
+    for (size_type idx{N}; idx < params0.size(); ++idx)
+    {
+        params0[idx] = factor(g);
+    }
+
+    vector_type tcol(m_y.size());
+    vector_type tsum(m_rank);
+
+    std::function<std::pair<value_type, vector_type> (const vector_type &)>
+
+    cost_fn = [this, &tcol, &tsum](const vector_type & params) -> std::pair<value_type, vector_type>
+    {
+        value_type cost;
+        vector_type grad(params.size());
+
+        num::fm_cost_grad(cost, grad, tcol, tsum, params, this->m_X, this->m_y, this->m_C, this->m_rank);
+
+        return std::make_pair(cost, grad);
+    };
+
+    return num::fmincg(cost_fn, params0, m_max_iter, false);
+}
+
+template<typename _ValueType>
+typename FactorizationMachine<_ValueType>::vector_type
+FactorizationMachine<_ValueType>::predict(const array_type & X, const vector_type & params) const
+{
+    vector_type H(X.shape().first);
+    vector_type tsum(m_rank);
+
+    fm_predict(H, tsum, params, X, m_rank);
+
+    return H;
+}
+
+template<typename _ValueType>
+typename FactorizationMachine<_ValueType>::vector_type
+FactorizationMachine<_ValueType>::predict(array_type && X, vector_type && params) const
+{
+    return predict(X, params);
+}
+
+} // namespace num
+
+#endif /* FM_HPP_ */
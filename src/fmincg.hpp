@@ -75,6 +75,7 @@
 #include <algorithm>
 #include <iostream>
 #include <functional>
+#include <limits>
 
 namespace num
 {
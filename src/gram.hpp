@@ -0,0 +1,428 @@
+/*******************************************************************************
+ * Copyright (c) 2015 Wojciech Migda
+ * All rights reserved
+ * Distributed under the terms of the GNU LGPL v3
+ *******************************************************************************
+ *
+ * Filename: gram.hpp
+ *
+ * Description:
+ *      Normal equations: Gram matrix with incremental updates, Cholesky solve
+ *
+ * Authors:
+ *          Wojciech Migda (wm)
+ *
+ *******************************************************************************
+ * History:
+ * --------
+ * Date         Who  Ticket     Description
+ * ----------   ---  ---------  ------------------------------------------------
+ * 2026-10-19   wm              Initial version
+ * 2026-10-19   wm              Changed cells given by the caller
+ *
+ ******************************************************************************/
+
+#ifndef GRAM_HPP_
+#define GRAM_HPP_
+
+#include "array2d.hpp"
+#include "num.hpp"
+
+#include <valarray>
+#include <vector>
+#include <algorithm>
+#include <tuple>
+#include <utility>
+#include <cmath>
+#include <cassert>
+
+namespace num
+{
+
+/*
+ * Solve A * x = b for symmetric positive definite A via Cholesky
+ * decomposition, A = L * L'. A is taken by value and overwritten with L.
+ */
+template<typename _ValueType>
+std::valarray<_ValueType>
+cholesky_solve(array2d<_ValueType> A, std::valarray<_ValueType> b)
+{
+    typedef _ValueType value_type;
+
+    const size_type N{A.shape().first};
+
+    assert(A.shape().second == N);
+    assert(b.size() == N);
+
+    for (size_type j{0}; j < N; ++j)
+    {
+        value_type diag = A.at(j, j);
+        for (size_type k{0}; k < j; ++k)
+        {
+            diag -= A.at(j, k) * A.at(j, k);
+        }
+        assert(diag > 0);
+        diag = std::sqrt(diag);
+        A.at(j, j) = diag;
+
+        for (size_type i{j + 1}; i < N; ++i)
+        {
+            value_type sum = A.at(i, j);
+            for (size_type k{0}; k < j; ++k)
+            {
+                sum -= A.at(i, k) * A.at(j, k);
+            }
+            A.at(i, j) = sum / diag;
+        }
+    }
+
+    // L * z = b
+    for (size_type i{0}; i < N; ++i)
+    {
+        for (size_type k{0}; k < i; ++k)
+        {
+            b[i] -= A.at(i, k) * b[k];
+        }
+        b[i] /= A.at(i, i);
+    }
+
+    // L' * x = z
+    for (size_type i{N}; i-- > 0; /* nop */)
+    {
+        for (size_type k{i + 1}; k < N; ++k)
+        {
+            b[i] -= A.at(k, i) * b[k];
+        }
+        b[i] /= A.at(i, i);
+    }
+
+    return b;
+}
+
+/*
+ * Direct ridge solution from the normal equations,
+ * (G + D / C) * theta = b, with G = X' * X, b = X' * y
+ * and D = diag(0, 1, ..., 1) leaving the intercept unregularized.
+ */
+template<typename _ValueType>
+std::valarray<_ValueType>
+ridge_normal_solve(
+    array2d<_ValueType> G,
+    std::valarray<_ValueType> b,
+    const _ValueType C)
+{
+    for (size_type c{1}; c < G.shape().first; ++c)
+    {
+        G.at(c, c) += 1.0 / C;
+    }
+
+    return cholesky_solve(std::move(G), std::move(b));
+}
+
+/**
+ *******************************************************************************
+ *   @brief X' * X and X' * y kept up to date across similar design matrices
+ *******************************************************************************
+ *   @history @code
+ *   DATE         VERSION    WHO     DESCRIPTION
+ *   -----------  -------    ------  -----------
+ *   2026-10-19              wm      Class created.
+ *   @endcode
+ *******************************************************************************
+ *   With intercept, kept for the augmented design [1 X] instead of X,
+ *   so that the caller needs no copy of X with a column of ones.
+ *
+ *   The caller tells @c update which cells of X may differ from the X of
+ *   the previous call, as rows per column: rows of column c are
+ *   cells[cell_offsets[c], cell_offsets[c + 1]). Only the values of
+ *   those cells are kept between calls, nothing is compared. First
+ *   @c update, or one with other cells, builds the Gram matrix from
+ *   scratch. Every later one only pays for the cells given:
+ *   - columns with more than 1/DENSE_FRACTION of their rows given are
+ *     recomputed as a whole, O(M * N) each,
+ *   - every other row given is applied as a rank-1 downdate of its old
+ *     value and a rank-1 update of its new one, restricted to the block
+ *     of remaining columns, O(N^2) per row.
+ *   The target is assumed to stay the same between updates.
+ *******************************************************************************
+ */
+template<typename _ValueType>
+class GramCache
+{
+public:
+    typedef _ValueType value_type;
+    typedef std::valarray<value_type> vector_type;
+    typedef array2d<value_type> array_type;
+
+    explicit GramCache(bool intercept = false);
+
+    void update(
+        const array_type & X,
+        const vector_type & y,
+        const std::vector<size_type> & cells,
+        const std::vector<size_type> & cell_offsets);
+
+    // from scratch, for a single design
+    void update(const array_type & X, const vector_type & y);
+
+    // of [1 X], with the intercept first, if so constructed
+    const array_type & gram(void) const;
+    const vector_type & Xty(void) const;
+
+    size_type updated_rows(void) const;
+    size_type updated_columns(void) const;
+
+private:
+    static constexpr size_type DENSE_FRACTION{4};
+
+    void rebuild(const array_type & X, const vector_type & y);
+    void rebuild_column(size_type c, const array_type & X, const vector_type & y);
+
+    // 1 with the intercept, where columns of X start in G
+    const size_type m_lead;
+
+    array_type m_G;
+    vector_type m_b;
+    shape_type m_shape;
+
+    // cells of the last update and their values then
+    std::vector<size_type> m_cells;
+    std::vector<size_type> m_cell_offsets;
+    std::vector<value_type> m_old;
+
+    bool m_valid;
+    size_type m_updated_rows;
+    size_type m_updated_columns;
+};
+
+template<typename _ValueType>
+GramCache<_ValueType>::GramCache(bool intercept)
+:
+    m_lead{intercept ? 1u : 0u},
+    m_G{shape_type(0, 0), 0.0},
+    m_b{},
+    m_shape(0, 0),
+    m_cells{},
+    m_cell_offsets{},
+    m_old{},
+    m_valid{false},
+    m_updated_rows{0},
+    m_updated_columns{0}
+{
+}
+
+template<typename _ValueType>
+void
+GramCache<_ValueType>::rebuild_column(size_type c, const array_type & X, const vector_type & y)
+{
+    const size_type N{X.shape().second};
+    const size_type L{m_lead};
+    const vector_type col = X[X.column(c)];
+
+    if (L != 0)
+    {
+        m_G.at(0, c + L) = col.sum();
+        m_G.at(c + L, 0) = m_G.at(0, c + L);
+    }
+
+    for (size_type k{0}; k < N; ++k)
+    {
+        const value_type dot = (col * X[X.column(k)]).sum();
+
+        m_G.at(c + L, k + L) = dot;
+        m_G.at(k + L, c + L) = dot;
+    }
+    m_b[c + L] = (col * y).sum();
+}
+
+template<typename _ValueType>
+void
+GramCache<_ValueType>::rebuild(const array_type & X, const vector_type & y)
+{
+    const size_type M{X.shape().first};
+    const size_type N{X.shape().second};
+
+    m_G = zeros<value_type>({N + m_lead, N + m_lead});
+    m_b = vector_type(0.0, N + m_lead);
+
+    if (m_lead != 0)
+    {
+        m_G.at(0, 0) = M;
+        m_b[0] = y.sum();
+    }
+
+    for (size_type c{0}; c < N; ++c)
+    {
+        rebuild_column(c, X, y);
+    }
+
+    m_shape = X.shape();
+    m_valid = true;
+    m_updated_rows = M;
+    m_updated_columns = N;
+}
+
+template<typename _ValueType>
+void
+GramCache<_ValueType>::update(
+    const array_type & X,
+    const vector_type & y,
+    const std::vector<size_type> & cells,
+    const std::vector<size_type> & cell_offsets)
+{
+    const size_type M{X.shape().first};
+    const size_type N{X.shape().second};
+
+    assert(y.size() == M);
+    assert(cell_offsets.size() == N + 1);
+    assert(cell_offsets.back() == cells.size());
+
+    if (!m_valid || m_shape != X.shape() || m_cells != cells || m_cell_offsets != cell_offsets)
+    {
+        rebuild(X, y);
+
+        m_cells = cells;
+        m_cell_offsets = cell_offsets;
+    }
+    else
+    {
+        std::vector<size_type> dense_cols;
+        std::vector<size_type> sparse_cols;
+        std::vector<size_type> sparse_pos(N);
+
+        for (size_type c{0}; c < N; ++c)
+        {
+            const size_type changes{cell_offsets[c + 1] - cell_offsets[c]};
+
+            if (changes * DENSE_FRACTION > M)
+            {
+                dense_cols.push_back(c);
+            }
+            else
+            {
+                sparse_pos[c] = sparse_cols.size();
+                sparse_cols.push_back(c);
+            }
+        }
+
+        // cells of the sparsely changed columns, as (row, column, index into cells), by row
+        std::vector<std::tuple<size_type, size_type, size_type>> by_row;
+        for (auto c : sparse_cols)
+        {
+            for (size_type k{cell_offsets[c]}; k < cell_offsets[c + 1]; ++k)
+            {
+                by_row.emplace_back(cells[k], c, k);
+            }
+        }
+        std::sort(by_row.begin(), by_row.end());
+
+        std::vector<value_type> x_new(sparse_cols.size());
+        std::vector<value_type> x_old(sparse_cols.size());
+        size_type nrows{0};
+
+        for (size_type first{0}, last{0}; first < by_row.size(); first = last)
+        {
+            const size_type r{std::get<0>(by_row[first])};
+
+            for (size_type i{0}; i < sparse_cols.size(); ++i)
+            {
+                x_new[i] = X.at(r, sparse_cols[i]);
+                x_old[i] = x_new[i];
+            }
+            for (last = first; last < by_row.size() && std::get<0>(by_row[last]) == r; ++last)
+            {
+                x_old[sparse_pos[std::get<1>(by_row[last])]] = m_old[std::get<2>(by_row[last])];
+            }
+
+            for (size_type i{0}; i < sparse_cols.size(); ++i)
+            {
+                const size_type ci{sparse_cols[i] + m_lead};
+
+                if (m_lead != 0)
+                {
+                    m_G.at(0, ci) += x_new[i] - x_old[i];
+                    m_G.at(ci, 0) = m_G.at(0, ci);
+                }
+
+                for (size_type j{i}; j < sparse_cols.size(); ++j)
+                {
+                    const size_type cj{sparse_cols[j] + m_lead};
+                    const value_type delta = x_new[i] * x_new[j] - x_old[i] * x_old[j];
+
+                    m_G.at(ci, cj) += delta;
+                    if (ci != cj)
+                    {
+                        m_G.at(cj, ci) += delta;
+                    }
+                }
+                m_b[ci] += (x_new[i] - x_old[i]) * y[r];
+            }
+            ++nrows;
+        }
+
+        // dense columns last, their rows/columns of G get overwritten in full
+        for (auto c : dense_cols)
+        {
+            rebuild_column(c, X, y);
+        }
+
+        m_updated_rows = nrows;
+        m_updated_columns = dense_cols.size();
+    }
+
+    m_old.resize(cells.size());
+    for (size_type c{0}; c < N; ++c)
+    {
+        for (size_type k{cell_offsets[c]}; k < cell_offsets[c + 1]; ++k)
+        {
+            m_old[k] = X.at(cells[k], c);
+        }
+    }
+}
+
+template<typename _ValueType>
+void
+GramCache<_ValueType>::update(const array_type & X, const vector_type & y)
+{
+    rebuild(X, y);
+
+    m_cells.clear();
+    m_cell_offsets.clear();
+    m_old.clear();
+}
+
+template<typename _ValueType>
+inline
+const typename GramCache<_ValueType>::array_type &
+GramCache<_ValueType>::gram(void) const
+{
+    return m_G;
+}
+
+template<typename _ValueType>
+inline
+const typename GramCache<_ValueType>::vector_type &
+GramCache<_ValueType>::Xty(void) const
+{
+    return m_b;
+}
+
+template<typename _ValueType>
+inline
+size_type
+GramCache<_ValueType>::updated_rows(void) const
+{
+    return m_updated_rows;
+}
+
+template<typename _ValueType>
+inline
+size_type
+GramCache<_ValueType>::updated_columns(void) const
+{
+    return m_updated_columns;
+}
+
+} // namespace num
+
+#endif /* GRAM_HPP_ */
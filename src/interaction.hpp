@@ -0,0 +1,335 @@
+/*******************************************************************************
+ * Copyright (c) 2015 Wojciech Migda
+ * All rights reserved
+ * Distributed under the terms of the GNU LGPL v3
+ *******************************************************************************
+ *
+ * Filename: interaction.hpp
+ *
+ * Description:
+ *      Design matrix with implicit pairwise interaction columns
+ *
+ * Authors:
+ *          Wojciech Migda (wm)
+ *
+ *******************************************************************************
+ * History:
+ * --------
+ * Date         Who  Ticket     Description
+ * ----------   ---  ---------  ------------------------------------------------
+ * 2026-10-19   wm              Initial version
+ *
+ ******************************************************************************/
+
+#ifndef INTERACTION_HPP_
+#define INTERACTION_HPP_
+
+#include "array2d.hpp"
+#include "blas.hpp"
+#include "num.hpp"
+
+#include <valarray>
+#include <utility>
+#include <functional>
+#include <cassert>
+
+namespace num
+{
+
+/**
+ *******************************************************************************
+ *   @brief Intercept, base columns and their pairwise products, all scaled
+ *******************************************************************************
+ *   @history @code
+ *   DATE         VERSION    WHO     DESCRIPTION
+ *   -----------  -------    ------  -----------
+ *   2026-10-19              wm      Class created.
+ *   @endcode
+ *******************************************************************************
+ *   Stands in for the M x (1 + N + P) design matrix
+ *
+ *       [1, B[:, 0] / d_0, ..., B[:, i_p] * B[:, j_p] / d_(N + p), ...]
+ *
+ *   while storing only the M x N base matrix B and 1 + N + P deviations.
+ *   Products and scaling are evaluated on the fly inside @c mul, so that
+ *   memory is O(M * N) no matter how many pairs there are.
+ *
+ *   Deviations are num::std of the respective (product) columns of B,
+ *   the scaling standardize_X_data applies; a test design takes those
+ *   of the training design it is constructed with.
+ *******************************************************************************
+ */
+template<typename _ValueType>
+class InteractionDesign
+{
+public:
+    typedef _ValueType value_type;
+    typedef std::valarray<value_type> vector_type;
+    typedef array2d<value_type> array_type;
+    typedef std::valarray<std::pair<size_type, size_type>> pairs_type;
+    typedef typename array_type::Axis Axis;
+
+    /*
+     * Deviations taken from base itself
+     */
+    InteractionDesign(array_type && base, const pairs_type & pairs);
+
+    /*
+     * Pairs and deviations taken from a (training) design
+     */
+    InteractionDesign(array_type && base, const InteractionDesign & like);
+
+    shape_type shape(void) const;
+
+    /*
+     * Same contract as array2d::mul
+     */
+    void mul(
+        const Axis,
+        const vector_type & ivector,
+        vector_type & ovector) const;
+
+    template<typename _Op>
+    void mul(
+        const Axis,
+        const vector_type & ivector,
+        vector_type & ovector,
+        _Op op) const;
+
+    /*
+     * The dense design matrix this one stands in for
+     */
+    array_type materialize(void) const;
+
+    /*
+     * Squared norm of every column of the design
+     */
+    vector_type sq_column_norms(void) const;
+
+private:
+    array_type m_base;
+    pairs_type m_pairs;
+    vector_type m_dev;
+};
+
+template<typename _ValueType>
+InteractionDesign<_ValueType>::InteractionDesign(array_type && base, const pairs_type & pairs)
+:
+    m_base(std::move(base)),
+    m_pairs(pairs),
+    m_dev(1.0, 1 + m_base.shape().second + pairs.size())
+{
+    const size_type N{m_base.shape().second};
+
+    for (size_type c{0}; c < N; ++c)
+    {
+        m_dev[1 + c] = num::std<value_type>(m_base[m_base.column(c)]);
+    }
+    for (size_type p{0}; p < m_pairs.size(); ++p)
+    {
+        m_dev[1 + N + p] = num::std<value_type>(
+            (vector_type)m_base[m_base.column(m_pairs[p].first)] *
+            (vector_type)m_base[m_base.column(m_pairs[p].second)]);
+    }
+}
+
+template<typename _ValueType>
+InteractionDesign<_ValueType>::InteractionDesign(array_type && base, const InteractionDesign & like)
+:
+    m_base(std::move(base)),
+    m_pairs(like.m_pairs),
+    m_dev(like.m_dev)
+{
+    assert(m_base.shape().second == like.m_base.shape().second);
+}
+
+template<typename _ValueType>
+inline
+shape_type
+InteractionDesign<_ValueType>::shape(void) const
+{
+    return {m_base.shape().first, m_dev.size()};
+}
+
+template<typename _ValueType>
+inline
+void
+InteractionDesign<_ValueType>::mul(
+    const Axis axis,
+    const vector_type & ivector,
+    vector_type & ovector) const
+{
+    mul(axis, ivector, ovector,
+        [](const value_type &, const value_type & rhs) -> value_type
+        {
+            return rhs;
+        }
+    );
+}
+
+template<typename _ValueType>
+template<typename _Op>
+void
+InteractionDesign<_ValueType>::mul(
+    const Axis axis,
+    const vector_type & ivector,
+    vector_type & ovector,
+    _Op op) const
+{
+    const size_type M{m_base.shape().first};
+    const size_type N{m_base.shape().second};
+    const size_type P{m_pairs.size()};
+    const value_type * data = m_base.data();
+
+    if (axis == Axis::Row)
+    {
+        assert(ivector.size() == 1 + N + P);
+        assert(ovector.size() == M);
+
+        // scaling folded into the weights once
+        const vector_type w = ivector / m_dev;
+
+        for (size_type r{0}; r < M; ++r)
+        {
+            const value_type * row = data + r * N;
+
+            value_type acc = w[0] + dot(row, &w[1], N);
+
+            for (size_type p{0}; p < P; ++p)
+            {
+                acc += row[m_pairs[p].first] * row[m_pairs[p].second] * w[1 + N + p];
+            }
+
+            ovector[r] = op(ovector[r], acc);
+        }
+    }
+    else
+    {
+        assert(ivector.size() == M);
+        assert(ovector.size() == 1 + N + P);
+
+        vector_type acc(0.0, 1 + N + P);
+
+        for (size_type r{0}; r < M; ++r)
+        {
+            const value_type * row = data + r * N;
+            const value_type h = ivector[r];
+
+            acc[0] += h;
+            for (size_type c{0}; c < N; ++c)
+            {
+                acc[1 + c] += row[c] * h;
+            }
+            for (size_type p{0}; p < P; ++p)
+            {
+                acc[1 + N + p] += row[m_pairs[p].first] * row[m_pairs[p].second] * h;
+            }
+        }
+
+        acc /= m_dev;
+
+        for (size_type c{0}; c < acc.size(); ++c)
+        {
+            ovector[c] = op(ovector[c], acc[c]);
+        }
+    }
+}
+
+template<typename _ValueType>
+typename InteractionDesign<_ValueType>::array_type
+InteractionDesign<_ValueType>::materialize(void) const
+{
+    const size_type N{m_base.shape().second};
+
+    array_type result = ones<value_type>(shape());
+
+    for (size_type c{0}; c < N; ++c)
+    {
+        result[result.column(1 + c)] = (vector_type)m_base[m_base.column(c)] / m_dev[1 + c];
+    }
+    for (size_type p{0}; p < m_pairs.size(); ++p)
+    {
+        result[result.column(1 + N + p)] =
+            (vector_type)m_base[m_base.column(m_pairs[p].first)] *
+            (vector_type)m_base[m_base.column(m_pairs[p].second)] / m_dev[1 + N + p];
+    }
+
+    return result;
+}
+
+template<typename _ValueType>
+typename InteractionDesign<_ValueType>::vector_type
+InteractionDesign<_ValueType>::sq_column_norms(void) const
+{
+    const size_type M{m_base.shape().first};
+    const size_type N{m_base.shape().second};
+    const size_type P{m_pairs.size()};
+    const value_type * data = m_base.data();
+
+    vector_type result(0.0, 1 + N + P);
+
+    for (size_type r{0}; r < M; ++r)
+    {
+        const value_type * row = data + r * N;
+
+        result[0] += 1;
+        for (size_type c{0}; c < N; ++c)
+        {
+            result[1 + c] += row[c] * row[c];
+        }
+        for (size_type p{0}; p < P; ++p)
+        {
+            const value_type x = row[m_pairs[p].first] * row[m_pairs[p].second];
+
+            result[1 + N + p] += x * x;
+        }
+    }
+
+    return result / (m_dev * m_dev);
+}
+
+/*
+ * Kernels of blas.hpp on an implicit design
+ */
+template<typename _ValueType>
+inline
+void
+gemv(
+    const typename array2d<_ValueType>::Axis axis,
+    const InteractionDesign<_ValueType> & X,
+    const std::valarray<_ValueType> & ivector,
+    std::valarray<_ValueType> & ovector)
+{
+    X.mul(axis, ivector, ovector);
+}
+
+template<typename _ValueType>
+inline
+std::valarray<_ValueType>
+sq_column_norms(const InteractionDesign<_ValueType> & X)
+{
+    return X.sq_column_norms();
+}
+
+/*
+ * Dense matrix for solvers which need one, a no-op for array2d
+ */
+template<typename _ValueType>
+inline
+const array2d<_ValueType> &
+dense(const array2d<_ValueType> & X)
+{
+    return X;
+}
+
+template<typename _ValueType>
+inline
+array2d<_ValueType>
+dense(const InteractionDesign<_ValueType> & X)
+{
+    return X.materialize();
+}
+
+} // namespace num
+
+#endif /* INTERACTION_HPP_ */
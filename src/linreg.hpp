@@ -18,6 +18,7 @@
  * Date         Who  Ticket     Description
  * ----------   ---  ---------  ------------------------------------------------
  * 2015-02-22   wm              Initial version
+ * 2026-10-19   wm              LinearRegression generic over the design matrix type
  *
  ******************************************************************************/
 
@@ -26,6 +27,9 @@
 
 #include "array2d.hpp"
 #include "fmincg.hpp"
+#include "ridgecg.hpp"
+#include "gram.hpp"
+#include "interaction.hpp"
 #include "num.hpp"
 
 #include <valarray>
@@ -36,7 +40,10 @@
 namespace num
 {
 
-template<typename _ValueType>
+/*
+ * X is an array2d or any design type with the same vector mul (InteractionDesign)
+ */
+template<typename _ValueType, typename _DesignType = array2d<_ValueType>>
 void
 linreg_cost_grad(
     /// out
@@ -45,7 +52,7 @@ linreg_cost_grad(
     std::valarray<_ValueType> & tcol,
     /// in
     const std::valarray<_ValueType> & theta,
-    const array2d<_ValueType> & X,
+    const _DesignType & X,
     const std::valarray<_ValueType> & y,
     const _ValueType C
 )
@@ -85,6 +92,64 @@ linreg_cost_grad(
     out_grad /= X_shape.first;
 }
 
+/*
+ * Batched variant of the above: K thetas, stacked as columns of Theta,
+ * each with its own C, evaluated against the same X and y with two
+ * matrix-matrix products instead of 2K matrix-vector ones.
+ */
+template<typename _ValueType>
+void
+linreg_cost_grad(
+    /// out
+    std::valarray<_ValueType> & out_cost,
+    array2d<_ValueType> & out_grad,
+    array2d<_ValueType> & tmat,
+    /// in
+    const array2d<_ValueType> & Theta,
+    const array2d<_ValueType> & X,
+    const std::valarray<_ValueType> & y,
+    const std::valarray<_ValueType> & C
+)
+{
+    typedef _ValueType value_type;
+    typedef std::valarray<value_type> vector_type;
+    typedef array2d<value_type> array_type;
+
+    const shape_type X_shape = X.shape();
+    const size_type K{Theta.shape().second};
+
+    assert(y.size() == X_shape.first);
+    assert(Theta.shape().first == X_shape.second);
+    assert(C.size() == K);
+    assert(out_cost.size() == K);
+    assert(out_grad.shape() == Theta.shape());
+    assert(tmat.shape() == shape_type(X_shape.first, K));
+
+    array_type & H = tmat;
+
+    //    H = X * Theta - y;
+    X.mul(array_type::Axis::Row, Theta, H);
+    //    G = X' * H;
+    for (size_type k{0}; k < K; ++k)
+    {
+        H[H.column(k)] -= y;
+    }
+    X.mul(array_type::Axis::Column, H, out_grad);
+
+    for (size_type k{0}; k < K; ++k)
+    {
+        const vector_type h = H[H.column(k)];
+        const vector_type theta = Theta[Theta.column(k)];
+
+        out_cost[k] = ((h * h).sum() + ((theta * theta).sum() - theta[0] * theta[0]) / C[k]) / (2.0 * X_shape.first);
+
+        vector_type grad = theta / C[k];
+        grad[0] = 0.0;
+        grad += vector_type(out_grad[out_grad.column(k)]);
+        out_grad[out_grad.column(k)] = grad / value_type(X_shape.first);
+    }
+}
+
 template<typename _ValueType>
 std::pair<_ValueType, std::valarray<_ValueType>>
 linreg_cost_grad(
@@ -108,60 +173,112 @@ linreg_cost_grad(
     return std::make_pair(cost, grad);
 }
 
-template<typename _ValueType>
+enum class Solver
+{
+    // nonlinear CG with line search
+    FMinCG,
+    // linear CG on the normal equations
+    CG,
+    // linear CG with Jacobi preconditioner
+    PCG,
+    // Cholesky solve of the normal equations
+    Normal,
+    // linear CG in double with long double iterative refinement
+    Mixed
+};
+
+/*
+ * _DesignType other than array2d (InteractionDesign) is used as is by
+ * the CG and FMinCG solvers and materialized for Normal and Mixed
+ */
+template<typename _ValueType, typename _DesignType = array2d<_ValueType>>
 class LinearRegression
 {
 public:
     typedef _ValueType value_type;
     typedef std::valarray<value_type> vector_type;
     typedef array2d<value_type> array_type;
+    typedef _DesignType design_type;
 
     LinearRegression(
-        array_type && X,
+        design_type && X,
         vector_type && y,
         vector_type && theta0,
         value_type C,
-        size_type max_iter
+        size_type max_iter,
+        Solver solver = Solver::FMinCG
     );
 
     vector_type
     fit(void) const;
 
+    /*
+     * Fit one theta per C, all on the same X and y,
+     * starting from the columns of Theta0
+     */
+    array_type
+    fit_batch(const array_type & Theta0, const vector_type & Cs) const;
+
     vector_type
-    predict(const array_type & X, const vector_type & theta) const;
+    predict(const design_type & X, const vector_type & theta) const;
+
+    /*
+     * Predictions for every column of Theta, one column each
+     */
+    array_type
+    predict_batch(const array_type & X, const array_type & Theta) const;
 
     vector_type
-    predict(array_type && X, vector_type && theta) const;
+    predict(design_type && X, vector_type && theta) const;
 
 private:
-    const array_type m_X;
+    const design_type m_X;
     const vector_type m_y;
     const vector_type m_theta0;
     const value_type m_C;
     const size_type m_max_iter;
+    const Solver m_solver;
 };
 
-template<typename _ValueType>
-LinearRegression<_ValueType>::LinearRegression(
-    array_type && X,
+template<typename _ValueType, typename _DesignType>
+LinearRegression<_ValueType, _DesignType>::LinearRegression(
+    design_type && X,
     vector_type && y,
     vector_type && theta0,
     value_type C,
-    size_type max_iter
+    size_type max_iter,
+    Solver solver
 )
 :
     m_X{std::move(X)},
     m_y{std::move(y)},
-    m_theta0{m_theta0.size() == m_X.shape().second ? std::move(theta0) : vector_type(m_X.shape().second)},
+    m_theta0{theta0.size() == m_X.shape().second ? std::move(theta0) : vector_type(m_X.shape().second)},
     m_C{C},
-    m_max_iter{max_iter}
+    m_max_iter{max_iter},
+    m_solver{solver}
 {
 }
 
-template<typename _ValueType>
-typename LinearRegression<_ValueType>::vector_type
-LinearRegression<_ValueType>::fit(void) const
+template<typename _ValueType, typename _DesignType>
+typename LinearRegression<_ValueType, _DesignType>::vector_type
+LinearRegression<_ValueType, _DesignType>::fit(void) const
 {
+    if (m_solver == Solver::Normal)
+    {
+        GramCache<value_type> gram;
+        gram.update(dense(m_X), m_y);
+
+        return num::ridge_normal_solve(gram.gram(), gram.Xty(), m_C);
+    }
+    else if (m_solver == Solver::Mixed)
+    {
+        return num::ridge_mixed(dense(m_X), m_y, m_theta0, m_C, m_max_iter);
+    }
+    else if (m_solver != Solver::FMinCG)
+    {
+        return num::ridge_cg(m_X, m_y, m_theta0, m_C, m_max_iter, m_solver == Solver::PCG);
+    }
+
     vector_type tcol(m_y.size());
 
     std::function<std::pair<value_type, vector_type> (const vector_type &)>
@@ -182,29 +299,76 @@ LinearRegression<_ValueType>::fit(void) const
     return theta;
 }
 
-template<typename _ValueType>
-typename LinearRegression<_ValueType>::vector_type
-LinearRegression<_ValueType>::predict(const array_type & X, const vector_type & theta) const
+template<typename _ValueType, typename _DesignType>
+typename LinearRegression<_ValueType, _DesignType>::array_type
+LinearRegression<_ValueType, _DesignType>::fit_batch(const array_type & Theta0, const vector_type & Cs) const
 {
-    assert(theta.size() == X.shape().second);
+    assert(Theta0.shape() == shape_type(m_X.shape().second, Cs.size()));
 
-    vector_type H(X.shape().first);
+    if (m_solver == Solver::CG || m_solver == Solver::PCG)
+    {
+        return num::ridge_cg_batch(dense(m_X), m_y, Theta0, Cs, m_max_iter, m_solver == Solver::PCG);
+    }
+
+    array_type Theta = Theta0;
+
+    GramCache<value_type> gram;
+    if (m_solver == Solver::Normal)
+    {
+        gram.update(dense(m_X), m_y);
+    }
 
-    for (size_type r{0}; r < X.shape().first; ++r)
+    for (size_type k{0}; k < Cs.size(); ++k)
     {
-        H[r] = (X[X.row(r)] * theta).sum();
+        if (m_solver == Solver::Normal)
+        {
+            Theta[Theta.column(k)] = num::ridge_normal_solve(gram.gram(), gram.Xty(), Cs[k]);
+        }
+        else
+        {
+            const LinearRegression regressor(
+                design_type{m_X}, vector_type{m_y}, Theta0[Theta0.column(k)], Cs[k], m_max_iter, m_solver);
+
+            Theta[Theta.column(k)] = regressor.fit();
+        }
     }
 
+    return Theta;
+}
+
+template<typename _ValueType, typename _DesignType>
+typename LinearRegression<_ValueType, _DesignType>::vector_type
+LinearRegression<_ValueType, _DesignType>::predict(const design_type & X, const vector_type & theta) const
+{
+    assert(theta.size() == X.shape().second);
+
+    vector_type H(X.shape().first);
+
+    X.mul(array_type::Axis::Row, theta, H);
+
     return H;
 }
 
-template<typename _ValueType>
-typename LinearRegression<_ValueType>::vector_type
-LinearRegression<_ValueType>::predict(array_type && X, vector_type && theta) const
+template<typename _ValueType, typename _DesignType>
+typename LinearRegression<_ValueType, _DesignType>::vector_type
+LinearRegression<_ValueType, _DesignType>::predict(design_type && X, vector_type && theta) const
 {
     return predict(X, theta);
 }
 
+template<typename _ValueType, typename _DesignType>
+typename LinearRegression<_ValueType, _DesignType>::array_type
+LinearRegression<_ValueType, _DesignType>::predict_batch(const array_type & X, const array_type & Theta) const
+{
+    assert(Theta.shape().first == X.shape().second);
+
+    array_type H = zeros<value_type>({X.shape().first, Theta.shape().second});
+
+    X.mul(array_type::Axis::Row, Theta, H);
+
+    return H;
+}
+
 } // namespace num
 
 #endif /* LINREG_HPP_ */
@@ -22,7 +22,8 @@
  ******************************************************************************/
 
 #include "ChildStuntedness5.hpp"
-#include "extract_subject_ranges.hpp"
+#include "cohort.hpp"
+#include "thread_pool.hpp"
 #include "num.hpp"
 
 #include <fstream>
@@ -38,6 +39,11 @@
 #include <utility>
 #include <cstring>
 #include <functional>
+#include <numeric>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <stdexcept>
 
 std::vector<std::string>
 read_file(std::string && fname)
@@ -54,174 +60,588 @@ read_file(std::string && fname)
     return vcsv;
 }
 
+/*
+ * Score of predictions for the test subjects of table, of a model trained
+ * on the train subjects, against predicting their mean IQ
+ */
+double
+prediction_score(
+    const num::Cohort<real_type> & table,
+    const std::vector<num::size_type> & train_subjects,
+    const std::vector<num::size_type> & test_subjects,
+    const std::vector<double> & prediction)
+{
+    assert(prediction.size() == test_subjects.size());
+
+    // geniq is the last subject column of the table
+    const num::size_type IQ_COL{table.subjects.shape().second - 1};
+
+    double mean_train_iq{0};
+    for (const auto sidx : train_subjects)
+    {
+        mean_train_iq += table.subjects.at(sidx, IQ_COL);
+    }
+    mean_train_iq /= train_subjects.size();
+
+    double SSE{0};
+    double SSE0{0};
+    for (num::size_type idx{0}; idx < test_subjects.size(); ++idx)
+    {
+        const double iq = table.subjects.at(test_subjects[idx], IQ_COL);
+
+        SSE += (prediction[idx] - iq) * (prediction[idx] - iq);
+        SSE0 += (mean_train_iq - iq) * (mean_train_iq - iq);
+    }
+
+    return 1e6 * std::max(0.0, 1.0 - SSE / SSE0);
+}
+
+/*
+ * prediction_score of the worker's predictions
+ */
+double
+split_score(
+    const ChildStuntedness5 & worker,
+    int scenario,
+    const num::Cohort<real_type> & table,
+    const std::vector<num::size_type> & train_subjects,
+    const std::vector<num::size_type> & test_subjects)
+{
+    const std::vector<double> prediction = worker.predict(
+        ChildStuntedness5::TestType::Example,
+        scenario,
+        ChildStuntedness5::take_subjects(scenario, table, train_subjects, true),
+        ChildStuntedness5::take_subjects(scenario, table, test_subjects, false));
+
+    return prediction_score(table, train_subjects, test_subjects, prediction);
+}
+
 int main(int argc, char **argv)
 {
-    const int SEED = (argc == 2 ? std::atoi(argv[1]) : 1);
-    const char * FNAME = (argc == 3 ? argv[2] : "../data/exampleData.csv");
+    const int SEED = (argc >= 2 ? std::atoi(argv[1]) : 1);
+    const char * FNAME = (argc >= 3 ? argv[2] : "../data/exampleData.csv");
+    const std::string MODE = (argc >= 4 ? argv[3] : "eval");
+    const std::string SOLVER = (argc >= 5 ? argv[4] : "fmincg");
+    const int THREADS = (argc >= 6 ? std::atoi(argv[5]) : 0);
+    const std::string ENCODING = (argc >= 7 ? argv[6] : "exact");
+    const std::string INTERACTIONS = (argc >= 8 ? argv[7] : "materialized");
+    const char * PAIRS = (argc >= 9 && std::strcmp(argv[8], "-") != 0 ? argv[8] : nullptr);
+    // cv mode: k folds as "k", or r repeated random splits as "rR"
+    const std::string FOLDS = (argc >= 10 ? argv[9] : "5");
+    // seconds per predict call, 0 for no limit
+    const double BUDGET = (argc >= 11 ? std::atof(argv[10]) : 0.0);
+    // Monte Carlo error of the ensemble average to stop at, 0 for fixed NREP
+    const double TOL = (argc >= 12 ? std::atof(argv[11]) : 0.0);
+
+    std::cerr << "SEED: " << SEED << ", CSV: " << FNAME << ", MODE: " << MODE << ", SOLVER: " << SOLVER << ", THREADS: " << THREADS << ", ENCODING: " << ENCODING << ", INTERACTIONS: " << INTERACTIONS << ", PAIRS: " << (PAIRS ? PAIRS : "default") << ", FOLDS: " << FOLDS << ", BUDGET: " << BUDGET << ", TOL: " << TOL << std::endl;
+
+    const std::map<std::string, num::Solver> solvers =
+    {
+        {"fmincg", num::Solver::FMinCG},
+        {"cg", num::Solver::CG},
+        {"pcg", num::Solver::PCG},
+        {"normal", num::Solver::Normal},
+        {"mixed", num::Solver::Mixed}
+    };
+    // not a solver but a different model, fitted with fmincg
+    const bool FM = (SOLVER == "fm");
+    if (!FM && solvers.find(SOLVER) == solvers.cend())
+    {
+        std::cerr << "SOLVER must be one of fm";
+        for (const auto & solver : solvers)
+        {
+            std::cerr << ", " << solver.first;
+        }
+        std::cerr << "; got \"" << SOLVER << "\"" << std::endl;
+        return 1;
+    }
+
+    const std::map<std::string, TargetEncoding> encodings =
+    {
+        {"exact", TargetEncoding::Exact},
+        {"binned", TargetEncoding::Binned}
+    };
+    if (encodings.find(ENCODING) == encodings.cend())
+    {
+        std::cerr << "ENCODING must be exact or binned; got \"" << ENCODING << "\"" << std::endl;
+        return 1;
+    }
+
+    if (INTERACTIONS != "materialized" && INTERACTIONS != "implicit")
+    {
+        std::cerr << "INTERACTIONS must be materialized or implicit; got \"" << INTERACTIONS << "\"" << std::endl;
+        return 1;
+    }
+
+    // feature pairs as written by the select mode
+    std::map<int, std::valarray<std::pair<num::size_type, num::size_type>>> pairs;
+    if (PAIRS)
+    {
+        std::ifstream fpairs(PAIRS);
+
+        if (!fpairs)
+        {
+            std::cerr << "Cannot open PAIRS file " << PAIRS << std::endl;
+            return 1;
+        }
+        try
+        {
+            pairs = read_feature_pairs(fpairs);
+        }
+        catch (const std::invalid_argument & ex)
+        {
+            std::cerr << PAIRS << ": " << ex.what() << std::endl;
+            return 1;
+        }
+    }
 
-    std::cerr << "SEED: " << SEED << ", CSV: " << FNAME << std::endl;
+    const PredictCfg cfg = PredictCfg()
+        .solver(FM ? num::Solver::FMinCG : solvers.at(SOLVER))
+        .model(FM ? Model::FM : Model::Linear)
+        .threads(THREADS)
+        .encoding(encodings.at(ENCODING))
+        .implicit_interactions(INTERACTIONS == "implicit")
+        .pairs(pairs)
+        .time_budget(BUDGET)
+        .ensemble_tol(TOL)
+        .seed(SEED);
+
+    // pairs set for a scenario must fit its design
+    for (int scenario{ScenarioType::S1}; scenario <= ScenarioType::S3; ++scenario)
+    {
+        try
+        {
+            cfg.pairs(scenario, cfg.visit_grid(scenario).width());
+        }
+        catch (const std::out_of_range & ex)
+        {
+            std::cerr << PAIRS << ": S" << scenario + 1 << ": " << ex.what() << std::endl;
+            return 1;
+        }
+    }
 
     const std::vector<std::string> vcsv = read_file(std::string(FNAME));
 
     std::cerr << "Read " << vcsv.size() << " lines" << std::endl;
 
-    std::vector<std::pair<num::size_type, num::size_type>> subject_ranges =
-        extract_subject_ranges(std::vector<std::string>{vcsv});
+    const ChildStuntedness5 worker(cfg);
+
+    // parsed once, train and test sets are subject indices into it
+    const num::Cohort<real_type> table = worker.load_table(vcsv);
+    const num::size_type NSUBJ{table.subject_ranges.size()};
+
+    std::vector<num::size_type> subjects(NSUBJ);
+    std::iota(subjects.begin(), subjects.end(), 0);
 
     std::mt19937 g(SEED);
-    std::shuffle(subject_ranges.begin(), subject_ranges.end(), g);
+    std::shuffle(subjects.begin(), subjects.end(), g);
 
-    const std::size_t PIVOT = 0.67 * subject_ranges.size();
+    const std::size_t PIVOT = 0.67 * NSUBJ;
 
-    std::vector<std::string> train_data;
-    std::vector<std::string> train_data0;
-    for (auto it = subject_ranges.cbegin(); it != subject_ranges.cbegin() + PIVOT; ++it)
-    {
-        train_data.insert(train_data.end(), vcsv.cbegin() + it->first, vcsv.cbegin() + it->second + 1);
-        train_data0.push_back(vcsv[it->second]);
-    }
+    const std::vector<num::size_type> train_subjects(subjects.cbegin(), subjects.cbegin() + PIVOT);
+    const std::vector<num::size_type> test_subjects(subjects.cbegin() + PIVOT, subjects.cend());
 
-    std::vector<std::string> test_data;
-    std::vector<std::string> test_data0;
-    for (auto it = subject_ranges.cbegin() + PIVOT; it != subject_ranges.cend(); ++it)
+    // per scenario, test subjects without geniq
+    const num::Cohort<real_type> training[] =
     {
-        test_data.insert(test_data.end(), vcsv.cbegin() + it->first, vcsv.cbegin() + it->second + 1);
-        test_data0.push_back(vcsv[it->second]);
-    }
+        ChildStuntedness5::take_subjects(ScenarioType::S1, table, train_subjects, true),
+        ChildStuntedness5::take_subjects(ScenarioType::S2, table, train_subjects, true),
+        ChildStuntedness5::take_subjects(ScenarioType::S3, table, train_subjects, true)
+    };
+    const num::Cohort<real_type> testing[] =
+    {
+        ChildStuntedness5::take_subjects(ScenarioType::S1, table, test_subjects, false),
+        ChildStuntedness5::take_subjects(ScenarioType::S2, table, test_subjects, false),
+        ChildStuntedness5::take_subjects(ScenarioType::S3, table, test_subjects, false)
+    };
 
-    std::cerr << "Train data has " << PIVOT << " IDs" << std::endl;
-    std::cerr << "Train data has " << train_data.size() << " rows" << std::endl;
-    std::cerr << "Train data 0 has " << train_data0.size() << " rows" << std::endl;
-    std::cerr << "Test data has " << subject_ranges.size() - PIVOT << " IDs" << std::endl;
-    std::cerr << "Test data has " << test_data.size() << " rows" << std::endl;
-    std::cerr << "Test data 0 has " << test_data0.size() << " rows" << std::endl;
+    std::cerr << "Train data has " << train_subjects.size() << " IDs" << std::endl;
+    std::cerr << "Train data has " << training[ScenarioType::S2].visits.shape().first << " rows" << std::endl;
+    std::cerr << "Test data has " << test_subjects.size() << " IDs" << std::endl;
+    std::cerr << "Test data has " << testing[ScenarioType::S2].visits.shape().first << " rows" << std::endl;
 
-    assert(train_data.size() + test_data.size() == vcsv.size());
-    assert(train_data0.size() + test_data0.size() == subject_ranges.size());
+    assert(training[ScenarioType::S2].visits.shape().first + testing[ScenarioType::S2].visits.shape().first ==
+        vcsv.size());
+
+    ////////////////////////////////////////////////////////////////////////////
 
-    for (auto item : test_data)
+    if (MODE == "tune")
     {
-        constexpr num::size_type IQ_COL{26};
+        for (int scenario{ScenarioType::S1}; scenario <= ScenarioType::S3; ++scenario)
+        {
+            const num::RegPath<real_type> path =
+                worker.tune(scenario, training[scenario]);
 
-        std::size_t nth_comma{0};
+            for (num::size_type idx{0}; idx < path.C.size(); ++idx)
+            {
+                std::cerr << "C: " << path.C[idx]
+                    << " CV MSE: " << path.cv_mse[idx]
+                    << " +/- " << path.cv_std[idx] << std::endl;
+            }
+            std::cerr << "Best C " << scenario + 1 << ": " << path.best_C << std::endl;
+        }
 
-        item.resize(std::distance(item.cbegin(), std::find_if(item.cbegin(), item.cend(),
-            [&nth_comma](const char & ch)
+        return 0;
+    }
+    else if (MODE == "select")
+    {
+        // the selected pairs go to stdout, loadable as PAIRS
+        for (int scenario{ScenarioType::S1}; scenario <= ScenarioType::S3; ++scenario)
+        {
+            const num::PairSelection<real_type> selection =
+                worker.select_pairs(scenario, training[scenario]);
+
+            std::cout << "# S" << scenario + 1 << " base validation MSE: " << selection.valid_mse.front() << std::endl;
+            for (num::size_type idx{0}; idx < selection.pairs.size(); ++idx)
+            {
+                write_feature_pairs(std::cout, static_cast<enum ScenarioType>(scenario),
+                    {selection.pairs[idx]});
+                std::cerr << "S" << scenario + 1 << " #" << idx + 1 << " (" << selection.pairs[idx].first
+                    << ", " << selection.pairs[idx].second << ") validation MSE: "
+                    << selection.valid_mse[idx + 1] << std::endl;
+            }
+        }
+
+        return 0;
+    }
+    else if (MODE == "bench")
+    {
+        // the mixed precision solver must reproduce the long double solve
+        // to within this, relative to the largest coefficient
+        const real_type MIXED_TOL{1e-8};
+        bool within_tol{true};
+
+        for (int scenario{ScenarioType::S1}; scenario <= ScenarioType::S3; ++scenario)
+        {
+            const auto X_y = worker.design(scenario, training[scenario]);
+            const real_type C = ChildStuntedness5::default_C(scenario);
+
+            std::cerr << "S" << scenario + 1 << " design " << X_y.first.shape() << std::endl;
+
+            // the direct long double solve is the reference for all the others
+            const std::valarray<real_type> theta_ref = num::LinearRegression<real_type>(
+                num::array2d<real_type>{X_y.first},
+                std::valarray<real_type>{X_y.second},
+                std::valarray<real_type>{},
+                C,
+                0,
+                num::Solver::Normal
+            ).fit();
+
+            for (const auto & solver : solvers)
             {
-                if (ch == ',' && nth_comma == (IQ_COL - 1))
+                typedef num::LinearRegression<real_type> regressor_type;
+
+                const regressor_type regressor(
+                    regressor_type::array_type{X_y.first},
+                    regressor_type::vector_type{X_y.second},
+                    regressor_type::vector_type(0.0, X_y.first.shape().second),
+                    C,
+                    150,
+                    solver.second
+                );
+
+                const auto t0 = std::chrono::steady_clock::now();
+                const regressor_type::vector_type theta = regressor.fit();
+                const auto t1 = std::chrono::steady_clock::now();
+
+                real_type cost;
+                regressor_type::vector_type grad(theta.size());
+                regressor_type::vector_type tcol(X_y.second.size());
+                num::linreg_cost_grad(cost, grad, tcol, theta, X_y.first, X_y.second, C);
+
+                std::cerr << "  " << solver.first
+                    << " time: " << std::chrono::duration<double, std::milli>(t1 - t0).count() << " ms"
+                    << " cost: " << cost
+                    << " |grad|: " << std::sqrt((grad * grad).sum())
+                    << " max|theta - theta_normal|: " << std::abs(theta - theta_ref).max() << std::endl;
+
+                if (solver.second == num::Solver::Mixed)
                 {
-                    return true;
+                    const real_type rel_err =
+                        std::abs(theta - theta_ref).max() / std::max(real_type{1}, std::abs(theta_ref).max());
+                    const bool ok{rel_err <= MIXED_TOL};
+
+                    std::cerr << "  mixed vs normal relative error: " << rel_err
+                        << (ok ? " within " : " EXCEEDS ") << MIXED_TOL << std::endl;
+                    within_tol = within_tol && ok;
                 }
-                else
+            }
+
+            // whole C grid on the same design: K single fits vs one batched fit
+            {
+                typedef num::LinearRegression<real_type> regressor_type;
+
+                const regressor_type::vector_type Cs = num::logspace<real_type>(-2, 1, 16);
+                const regressor_type regressor(
+                    regressor_type::array_type{X_y.first},
+                    regressor_type::vector_type{X_y.second},
+                    regressor_type::vector_type{},
+                    C,
+                    150,
+                    num::Solver::CG
+                );
+                const regressor_type::array_type Theta0 =
+                    num::zeros<real_type>({X_y.first.shape().second, Cs.size()});
+
+                const auto t0 = std::chrono::steady_clock::now();
+                regressor_type::array_type Theta = Theta0;
+                for (num::size_type k{0}; k < Cs.size(); ++k)
                 {
-                    nth_comma += (ch == ',');
-                    return false;
+                    Theta[Theta.column(k)] = num::ridge_cg(X_y.first, X_y.second,
+                        regressor_type::vector_type(Theta0[Theta0.column(k)]), Cs[k], 150);
                 }
+                const auto t1 = std::chrono::steady_clock::now();
+                const regressor_type::array_type Theta_batch = regressor.fit_batch(Theta0, Cs);
+                const auto t2 = std::chrono::steady_clock::now();
+
+                regressor_type::vector_type cost(Cs.size());
+                regressor_type::array_type grad(Theta_batch.shape(), 0.0);
+                regressor_type::array_type tmat({X_y.first.shape().first, Cs.size()}, 0.0);
+                num::linreg_cost_grad(cost, grad, tmat, Theta_batch, X_y.first, X_y.second, Cs);
+
+                const regressor_type::vector_type diff =
+                    regressor_type::vector_type(Theta[Theta.columns(0, -1)]) -
+                    regressor_type::vector_type(Theta_batch[Theta_batch.columns(0, -1)]);
+
+                std::cerr << "  cg x" << Cs.size()
+                    << " time: " << std::chrono::duration<double, std::milli>(t1 - t0).count() << " ms"
+                    << ", batched: " << std::chrono::duration<double, std::milli>(t2 - t1).count() << " ms"
+                    << " max|dtheta|: " << std::abs(diff).max()
+                    << " max|grad|: " << std::abs(regressor_type::vector_type(grad[grad.columns(0, -1)])).max()
+                    << std::endl;
             }
-        )));
-        assert(std::count(item.cbegin(), item.cend(), ',') == (IQ_COL - 1));
+        }
+
+        return within_tol ? 0 : 1;
     }
+    else if (MODE == "cv")
+    {
+        // pairs of train and test subjects
+        std::vector<std::pair<std::vector<num::size_type>, std::vector<num::size_type>>> splits;
 
-    std::vector<double> test_iqs;
+        // a count of at least min taking up all of digits
+        auto parse_count = [](const char * digits, long min) -> long
+        {
+            char * end;
+            const long count = std::strtol(digits, &end, 10);
 
-    for (auto item : test_data0)
+            return (end != digits && *end == '\0' && count >= min) ? count : 0;
+        };
+
+        const bool repeated{!FOLDS.empty() && FOLDS[0] == 'r'};
+        const long count = repeated ?
+            parse_count(FOLDS.c_str() + 1, 1) :
+            parse_count(FOLDS.c_str(), 2);
+
+        if (count == 0 || (!repeated && static_cast<num::size_type>(count) > NSUBJ))
+        {
+            std::cerr << "FOLDS must be k, for k-fold CV with 2 <= k <= " << NSUBJ
+                << " (the subjects), or rN, for N >= 1 random splits; got \"" << FOLDS << "\"" << std::endl;
+            return 1;
+        }
+
+        if (repeated)
+        {
+            // the first one is the split of the eval mode
+            const num::size_type NSPLITS = count;
+
+            for (num::size_type split{0}; split < NSPLITS; ++split)
+            {
+                std::vector<num::size_type> order(NSUBJ);
+                std::iota(order.begin(), order.end(), 0);
+
+                std::mt19937 g(SEED + split);
+                std::shuffle(order.begin(), order.end(), g);
+
+                splits.emplace_back(
+                    std::vector<num::size_type>(order.cbegin(), order.cbegin() + PIVOT),
+                    std::vector<num::size_type>(order.cbegin() + PIVOT, order.cend()));
+            }
+        }
+        else
+        {
+            const num::size_type NFOLDS = count;
+
+            for (num::size_type fold{0}; fold < NFOLDS; ++fold)
+            {
+                const num::size_type first{fold * NSUBJ / NFOLDS};
+                const num::size_type last{(fold + 1) * NSUBJ / NFOLDS};
+
+                std::vector<num::size_type> train_fold(subjects.cbegin(), subjects.cbegin() + first);
+                train_fold.insert(train_fold.end(), subjects.cbegin() + last, subjects.cend());
+
+                splits.emplace_back(
+                    std::move(train_fold),
+                    std::vector<num::size_type>(subjects.cbegin() + first, subjects.cbegin() + last));
+            }
+        }
+
+        const num::size_type NSPLITS{splits.size()};
+
+        // every split of every scenario is a task, all sharing the worker's pool
+        std::vector<double> score(3 * NSPLITS);
+        std::vector<double> seconds(3 * NSPLITS);
+
+        const auto t0 = std::chrono::steady_clock::now();
+
+        worker.pool().parallel_for(3 * NSPLITS,
+            [&](const num::size_type task)
+            {
+                const int scenario = task / NSPLITS;
+                const auto & split = splits[task % NSPLITS];
+
+                const auto start = std::chrono::steady_clock::now();
+                score[task] = split_score(worker, scenario, table, split.first, split.second);
+                seconds[task] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            }
+        );
+
+        const double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+        for (int scenario{ScenarioType::S1}; scenario <= ScenarioType::S3; ++scenario)
+        {
+            const std::valarray<double> scores(&score[scenario * NSPLITS], NSPLITS);
+            const std::valarray<double> times(&seconds[scenario * NSPLITS], NSPLITS);
+
+            const double mean = scores.sum() / NSPLITS;
+            const std::valarray<double> dev = scores - mean;
+            const double sd = NSPLITS > 1 ? std::sqrt((dev * dev).sum() / (NSPLITS - 1)) : 0.0;
+
+            for (num::size_type split{0}; split < NSPLITS; ++split)
+            {
+                std::cerr << "S" << scenario + 1 << " split " << split + 1 << " score: " << scores[split]
+                    << " time: " << times[split] << " s" << std::endl;
+            }
+            std::cerr << "Score " << scenario + 1 << ": " << mean << " +/- " << sd
+                << " over " << NSPLITS << " splits, time: " << times.sum() << " s" << std::endl;
+        }
+        std::cerr << "Wall time: " << wall << " s" << std::endl;
+
+        return 0;
+    }
+    else if (MODE == "persist")
     {
-        constexpr num::size_type IQ_COL{26};
+        // trained once and saved as S<n>.model, then scored from the mapped file
+        for (int scenario{ScenarioType::S1}; scenario <= ScenarioType::S3; ++scenario)
+        {
+            const std::string path = "S" + std::to_string(scenario + 1) + ".model";
 
-        std::size_t nth_comma{0};
+            const auto t0 = std::chrono::steady_clock::now();
+            {
+                const ScenarioModel trained =
+                    worker.train(ChildStuntedness5::TestType::Example, scenario, training[scenario]);
 
-        test_iqs.push_back(std::atoi(std::strrchr(item.c_str(), ',') + 1));
+                std::ofstream fmodel(path, std::ios::binary);
+                trained.save(fmodel);
+                assert(fmodel);
+            }
+            const auto t1 = std::chrono::steady_clock::now();
 
-        item.resize(std::distance(item.cbegin(), std::find_if(item.cbegin(), item.cend(),
-            [&nth_comma](const char & ch)
+            std::unique_ptr<const ScenarioModel> model;
+            try
+            {
+                model.reset(new ScenarioModel(std::make_shared<const num::MappedFile>(path)));
+            }
+            catch (const std::runtime_error & ex)
             {
-                if (ch == ',' && nth_comma == (IQ_COL - 1))
+                std::cerr << path << ": " << ex.what() << std::endl;
+                return 1;
+            }
+
+            const std::vector<double> prediction = worker.predict_only(*model, testing[scenario]);
+            const auto t2 = std::chrono::steady_clock::now();
+
+            std::cerr << "S" << scenario + 1 << " model: " << path << ", " << model->bytes() << " bytes, "
+                << model->repetitions() << " repetitions, train: "
+                << std::chrono::duration<double>(t1 - t0).count() << " s, predict_only: "
+                << std::chrono::duration<double, std::milli>(t2 - t1).count() << " ms" << std::endl;
+            std::cerr << "Score " << scenario + 1 << ": "
+                << prediction_score(table, train_subjects, test_subjects, prediction) << std::endl;
+        }
+
+        return 0;
+    }
+    else if (MODE == "repro")
+    {
+        // predictions, and the sums they are built from, must not depend on the thread count
+        const num::size_type THREAD_COUNTS[] = {1, 4, 64};
+        bool identical{true};
+
+        std::mt19937 g(SEED);
+        std::uniform_real_distribution<real_type> dist(-1e3, 1e3);
+
+        for (const num::size_type size : {0u, 1u, 63u, 64u, 65u, 1000u, 123457u})
+        {
+            std::valarray<real_type> values(size);
+            std::generate(std::begin(values), std::end(values), [&g, &dist](){ return dist(g); });
+
+            const real_type ref = num::sum(values);
+
+            for (const num::size_type threads : THREAD_COUNTS)
+            {
+                num::ThreadPool pool(threads);
+                const real_type psum = size != 0 ? num::sum(pool, &values[0], size) : real_type{};
+
+                identical = identical && (psum == ref);
+            }
+        }
+        std::cerr << "sum: " << (identical ? "identical" : "DIFFERENT") << std::endl;
+
+        std::vector<double> reference[3];
+
+        for (const num::size_type threads : THREAD_COUNTS)
+        {
+            const ChildStuntedness5 tworker(PredictCfg(cfg).threads(threads));
+
+            for (int scenario{ScenarioType::S1}; scenario <= ScenarioType::S3; ++scenario)
+            {
+                const std::vector<double> prediction = tworker.predict(
+                    ChildStuntedness5::TestType::Example,
+                    scenario,
+                    training[scenario],
+                    testing[scenario]);
+
+                if (threads == THREAD_COUNTS[0])
                 {
-                    return true;
+                    reference[scenario] = prediction;
                 }
                 else
                 {
-                    nth_comma += (ch == ',');
-                    return false;
+                    const bool same = (prediction == reference[scenario]);
+
+                    std::cerr << "S" << scenario + 1 << " threads: " << threads
+                        << (same ? " identical" : " DIFFERENT") << std::endl;
+                    identical = identical && same;
                 }
             }
-        )));
-        assert(std::count(item.cbegin(), item.cend(), ',') == (IQ_COL - 1));
+        }
+
+        return identical ? 0 : 1;
     }
 
-    const double MEAN_TRAIN_IQ = std::accumulate(train_data0.cbegin(), train_data0.cend(), 0.0,
-        [](const double & sum, const std::string & item) -> double
-        {
-            return sum + std::atoi(std::strrchr(item.c_str(), ',') + 1);
-        }
-    ) / PIVOT;
+    // the three scenarios are independent, so they run as concurrent tasks,
+    // with their repetitions nested on the same pool
+    double score[3];
+    double seconds[3];
 
-    const double SSE0 = std::accumulate(test_iqs.cbegin(), test_iqs.cend(), 0.0,
-        [&MEAN_TRAIN_IQ](const double & sse, const double & iq) -> double
+    worker.pool().parallel_for(3,
+        [&](const num::size_type scenario)
         {
-            return sse + (iq - MEAN_TRAIN_IQ) * (iq - MEAN_TRAIN_IQ);
+            const auto start = std::chrono::steady_clock::now();
+            score[scenario] = split_score(worker, scenario, table, train_subjects, test_subjects);
+            seconds[scenario] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
         }
     );
 
-    ////////////////////////////////////////////////////////////////////////////
-
-    const ChildStuntedness5 worker;
-
-    auto sse_lambda = [](const double & lhs, const double & rhs) -> double
+    for (int scenario{ScenarioType::S1}; scenario <= ScenarioType::S3; ++scenario)
     {
-        return (lhs - rhs) * (lhs - rhs);
-    };
-
-    std::vector<double> prediction1 = worker.predict(
-        ChildStuntedness5::TestType::Example,
-        ScenarioType::S1,
-        train_data0,
-        test_data0);
-    assert(prediction1.size() == test_iqs.size());
-    const double SSE1 = std::inner_product(
-        prediction1.cbegin(),
-        prediction1.cend(),
-        test_iqs.cbegin(),
-        0.0,
-        std::plus<double>(),
-        sse_lambda);
-
-    std::vector<double> prediction2 = worker.predict(
-        ChildStuntedness5::TestType::Example,
-        ScenarioType::S2,
-        std::vector<std::string>{train_data},
-        std::vector<std::string>{test_data});
-    assert(prediction2.size() == test_iqs.size());
-    const double SSE2 = std::inner_product(
-        prediction2.cbegin(),
-        prediction2.cend(),
-        test_iqs.cbegin(),
-        0.0,
-        std::plus<double>(),
-        sse_lambda);
-
-    std::vector<double> prediction3 = worker.predict(
-        ChildStuntedness5::TestType::Example,
-        ScenarioType::S3,
-        train_data,
-        test_data);
-    assert(prediction3.size() == test_iqs.size());
-    const double SSE3 = std::inner_product(
-        prediction3.cbegin(),
-        prediction3.cend(),
-        test_iqs.cbegin(),
-        0.0,
-        std::plus<double>(),
-        sse_lambda);
-
-    auto score_lambda = [](const double SSE, const double SSE0) -> double
-    {
-        return 1e6 * std::max(0.0, 1.0 - SSE / SSE0);
-    };
-
-    std::cerr << "Score 1: " << score_lambda(SSE1, SSE0) << std::endl;
-    std::cerr << "Score 2: " << score_lambda(SSE2, SSE0) << std::endl;
-    std::cerr << "Score 3: " << score_lambda(SSE3, SSE0) << std::endl;
+        std::cerr << "S" << scenario + 1 << " latency: " << seconds[scenario] << " s" << std::endl;
+    }
+    for (int scenario{ScenarioType::S1}; scenario <= ScenarioType::S3; ++scenario)
+    {
+        std::cerr << "Score " << scenario + 1 << ": " << score[scenario] << std::endl;
+    }
 
     return 0;
 }
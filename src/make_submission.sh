@@ -1,5 +1,5 @@
 #!/bin/sh
 
-cat num.hpp fmincg.hpp array2d.hpp linreg.hpp extract_subject_ranges.hpp ChildStuntedness5.hpp | grep -v "#include \"" > submission.cpp
+cat num.hpp fmincg.hpp array2d.hpp blas.hpp ridgecg.hpp gram.hpp interaction.hpp fm.hpp linreg.hpp thread_pool.hpp regpath.hpp task_graph.hpp cohort.hpp pivot.hpp select.hpp density.hpp encoder.hpp blob.hpp ChildStuntedness5.hpp | grep -v "#include \"" > submission.cpp
 g++ -std=c++11 -c submission.cpp
 gvim submission.cpp &
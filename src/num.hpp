@@ -18,6 +18,7 @@
  * Date         Who  Ticket     Description
  * ----------   ---  ---------  ------------------------------------------------
  * 2015-02-08   wm              Initial version
+ * 2026-10-19   wm              Fixed-tree summation for mean and std
  *
  ******************************************************************************/
 
@@ -32,12 +33,58 @@ namespace num
 
 typedef std::size_t size_type;
 
+/*
+ * Summation over a fixed tree: leaves are runs of up to SUM_BLOCK
+ * elements added in order, inner nodes split their range in halves
+ * at a block boundary. The shape of the tree depends on the number
+ * of elements only, so any evaluation of it (the parallel one in
+ * thread_pool.hpp included) gives bit-identical results.
+ */
+constexpr size_type SUM_BLOCK{64};
+
+inline
+size_type
+sum_split(const size_type size)
+{
+    return ((size + SUM_BLOCK - 1) / SUM_BLOCK / 2) * SUM_BLOCK;
+}
+
+template<typename _ValueType>
+_ValueType sum(const _ValueType * data, const size_type size)
+{
+    typedef _ValueType value_type;
+
+    if (size <= SUM_BLOCK)
+    {
+        value_type result{};
+
+        for (size_type idx{0}; idx < size; ++idx)
+        {
+            result += data[idx];
+        }
+
+        return result;
+    }
+    else
+    {
+        const size_type half{sum_split(size)};
+
+        return sum(data, half) + sum(data + half, size - half);
+    }
+}
+
+template<typename _ValueType>
+_ValueType sum(const std::valarray<_ValueType> & vector)
+{
+    return vector.size() != 0 ? sum(&vector[0], vector.size()) : _ValueType{};
+}
+
 template<typename _ValueType>
 _ValueType mean(const std::valarray<_ValueType> & vector)
 {
     typedef _ValueType value_type;
 
-    const value_type result = vector.size() != 0 ? vector.sum() / vector.size() : value_type{};
+    const value_type result = vector.size() != 0 ? sum(vector) / vector.size() : value_type{};
 
     return result;
 }
@@ -56,7 +103,7 @@ _ValueType std(const std::valarray<_ValueType> & vector, const size_type ddof =
     const value_type mu = mean(vector);
 
     const value_type result = vector.size() != 0 ?
-        std::sqrt(((vector - mu) * (vector - mu)).sum() / (vector.size() - ddof)) :
+        std::sqrt(sum<value_type>((vector - mu) * (vector - mu)) / (vector.size() - ddof)) :
         value_type{};
 
     return result;
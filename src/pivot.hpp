@@ -0,0 +1,191 @@
+/*******************************************************************************
+ * Copyright (c) 2015 Wojciech Migda
+ * All rights reserved
+ * Distributed under the terms of the GNU LGPL v3
+ *******************************************************************************
+ *
+ * Filename: pivot.hpp
+ *
+ * Description:
+ *      Pivot of longitudinal visit rows into one row per subject
+ *
+ * Authors:
+ *          Wojciech Migda (wm)
+ *
+ *******************************************************************************
+ * History:
+ * --------
+ * Date         Who  Ticket     Description
+ * ----------   ---  ---------  ------------------------------------------------
+ * 2026-10-19   wm              Initial version
+ * 2026-10-19   wm              Pivot from a Cohort
+ *
+ ******************************************************************************/
+
+#ifndef PIVOT_HPP_
+#define PIVOT_HPP_
+
+#include "array2d.hpp"
+#include "cohort.hpp"
+#include "thread_pool.hpp"
+#include "num.hpp"
+
+#include <valarray>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#include <cassert>
+
+namespace num
+{
+
+/**
+ *******************************************************************************
+ *   @brief Visit ages of a pivoted row and the columns taken from each visit
+ *******************************************************************************
+ *   @history @code
+ *   DATE         VERSION    WHO     DESCRIPTION
+ *   -----------  -------    ------  -----------
+ *   2026-10-19              wm      Class created.
+ *   @endcode
+ *******************************************************************************
+ *   A pivoted row is the concatenation, in grid order, of the selected
+ *   columns of every visit. A visit row belongs to the grid age nearest
+ *   to its own, ties going to the earlier one.
+ *******************************************************************************
+ */
+template<typename _ValueType>
+struct VisitGrid
+{
+    typedef _ValueType value_type;
+
+    // in ascending order
+    std::vector<value_type> ages;
+    // one per age, column indices into the visit row followed
+    // by the subject row, see pivot_visits
+    std::vector<std::valarray<size_type>> selectors;
+
+    size_type width(void) const
+    {
+        size_type result{0};
+
+        for (const auto & selector : selectors)
+        {
+            result += selector.size();
+        }
+
+        return result;
+    }
+
+    size_type nearest(const value_type age) const
+    {
+        assert(!ages.empty());
+
+        const size_type upper = std::lower_bound(ages.cbegin(), ages.cend(), age) - ages.cbegin();
+
+        if (upper == 0)
+        {
+            return 0;
+        }
+        else if (upper == ages.size())
+        {
+            return upper - 1;
+        }
+        else
+        {
+            return (age - ages[upper - 1]) <= (ages[upper] - age) ? upper - 1 : upper;
+        }
+    }
+};
+
+/*
+ * One row per subject of cohort, laid out by grid. Visit ages are read
+ * from visit column age_col. Cells of grid ages without a visit are NaN;
+ * of several visits nearest to the same grid age the closest one (the
+ * first among equally close) is kept.
+ *
+ * Selectors index the visit row joined with the subject row, so that
+ * subject attributes can be placed next to any visit's measurements.
+ *
+ * Every visit row is scattered straight into its place in the result.
+ * Subjects are processed in blocks, concurrently on the pool.
+ */
+template<typename _ValueType>
+array2d<_ValueType>
+pivot_visits(
+    const Cohort<_ValueType> & cohort,
+    const size_type age_col,
+    const VisitGrid<_ValueType> & grid,
+    ThreadPool & pool
+)
+{
+    typedef _ValueType value_type;
+
+    assert(grid.ages.size() == grid.selectors.size());
+
+    constexpr size_type BLOCK{256};
+
+    const std::vector<std::pair<size_type, size_type>> & subject_ranges = cohort.subject_ranges;
+
+    const size_type NSUBJ{subject_ranges.size()};
+    const size_type NBINS{grid.ages.size()};
+    const size_type IN_WIDTH{cohort.visits.shape().second};
+    const size_type SUBJ_WIDTH{cohort.subjects.shape().second};
+    const size_type OUT_WIDTH{grid.width()};
+
+    std::vector<size_type> offsets(NBINS);
+    for (size_type bin{1}; bin < NBINS; ++bin)
+    {
+        offsets[bin] = offsets[bin - 1] + grid.selectors[bin - 1].size();
+    }
+
+    array2d<value_type> result({NSUBJ, OUT_WIDTH}, NAN);
+
+    assert(cohort.subjects.shape().first == NSUBJ);
+
+    const value_type * in = cohort.visits.data();
+    const value_type * subjects = cohort.subjects.data();
+    value_type * out = result.data();
+
+    pool.parallel_for((NSUBJ + BLOCK - 1) / BLOCK,
+        [&, in, subjects, out](const size_type block)
+        {
+            std::vector<value_type> distance(NBINS);
+
+            for (size_type sidx{block * BLOCK}; sidx < std::min(NSUBJ, (block + 1) * BLOCK); ++sidx)
+            {
+                std::fill(distance.begin(), distance.end(), std::numeric_limits<value_type>::infinity());
+
+                value_type * orow = out + sidx * OUT_WIDTH;
+                const value_type * srow = subjects + sidx * SUBJ_WIDTH;
+
+                for (size_type ridx{subject_ranges[sidx].first}; ridx <= subject_ranges[sidx].second; ++ridx)
+                {
+                    const value_type * irow = in + ridx * IN_WIDTH;
+                    const size_type bin = grid.nearest(irow[age_col]);
+                    const value_type dist = std::abs(irow[age_col] - grid.ages[bin]);
+
+                    if (dist < distance[bin])
+                    {
+                        const std::valarray<size_type> & selector = grid.selectors[bin];
+
+                        distance[bin] = dist;
+                        for (size_type k{0}; k < selector.size(); ++k)
+                        {
+                            orow[offsets[bin] + k] =
+                                selector[k] < IN_WIDTH ? irow[selector[k]] : srow[selector[k] - IN_WIDTH];
+                        }
+                    }
+                }
+            }
+        }
+    );
+
+    return result;
+}
+
+} // namespace num
+
+#endif /* PIVOT_HPP_ */
@@ -0,0 +1,373 @@
+/*******************************************************************************
+ * Copyright (c) 2015 Wojciech Migda
+ * All rights reserved
+ * Distributed under the terms of the GNU LGPL v3
+ *******************************************************************************
+ *
+ * Filename: regpath.hpp
+ *
+ * Description:
+ *      Cross-validated regularization path for ridge regression
+ *
+ * Authors:
+ *          Wojciech Migda (wm)
+ *
+ *******************************************************************************
+ * History:
+ * --------
+ * Date         Who  Ticket     Description
+ * ----------   ---  ---------  ------------------------------------------------
+ * 2026-10-19   wm              Initial version
+ * 2026-10-19   wm              Folds run on a ThreadPool
+ * 2026-10-19   wm              Cross-validation over designs made per fold
+ *
+ ******************************************************************************/
+
+#ifndef REGPATH_HPP_
+#define REGPATH_HPP_
+
+#include "array2d.hpp"
+#include "linreg.hpp"
+#include "thread_pool.hpp"
+#include "num.hpp"
+
+#include <valarray>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include <cassert>
+
+namespace num
+{
+
+/*
+ * numpy.logspace clone: num points spaced evenly on a log scale,
+ * from 10^start to 10^stop inclusive.
+ */
+template<typename _ValueType>
+std::valarray<_ValueType>
+logspace(const _ValueType start, const _ValueType stop, const size_type num)
+{
+    typedef _ValueType value_type;
+
+    std::valarray<value_type> result(num);
+
+    for (size_type idx{0}; idx < num; ++idx)
+    {
+        const value_type exponent = num > 1 ?
+            start + (stop - start) * idx / (num - 1) :
+            start;
+
+        result[idx] = std::pow(value_type(10), exponent);
+    }
+
+    return result;
+}
+
+/**
+ *******************************************************************************
+ *   @brief Outcome of the regularization path search
+ *******************************************************************************
+ *   @history @code
+ *   DATE         VERSION    WHO     DESCRIPTION
+ *   -----------  -------    ------  -----------
+ *   2026-10-19              wm      Class created.
+ *   @endcode
+ *******************************************************************************
+ */
+template<typename _ValueType>
+struct RegPath
+{
+    typedef _ValueType value_type;
+    typedef std::valarray<value_type> vector_type;
+
+    // regularization strength with the lowest mean validation error
+    value_type best_C;
+    // the grid, in the order it was fitted
+    vector_type C;
+    // mean and standard deviation (across folds) of the validation MSE
+    vector_type cv_mse;
+    vector_type cv_std;
+};
+
+/**
+ *******************************************************************************
+ *   @brief Training and validation sides of a cross-validation fold
+ *******************************************************************************
+ *   @history @code
+ *   DATE         VERSION    WHO     DESCRIPTION
+ *   -----------  -------    ------  -----------
+ *   2026-10-19              wm      Class created.
+ *   @endcode
+ *******************************************************************************
+ */
+template<typename _ValueType>
+struct FoldData
+{
+    array2d<_ValueType> X_train;
+    std::valarray<_ValueType> y_train;
+    array2d<_ValueType> X_valid;
+    std::valarray<_ValueType> y_valid;
+};
+
+/*
+ * Gather selected rows of the design matrix (and the target) into new arrays
+ */
+template<typename _ValueType>
+array2d<_ValueType>
+take_rows(const array2d<_ValueType> & X, const std::vector<size_type> & rows)
+{
+    array2d<_ValueType> result = zeros<_ValueType>({rows.size(), X.shape().second});
+
+    for (size_type ridx{0}; ridx < rows.size(); ++ridx)
+    {
+        result[result.row(ridx)] = X[X.row(rows[ridx])];
+    }
+
+    return result;
+}
+
+template<typename _ValueType>
+std::valarray<_ValueType>
+take_rows(const std::valarray<_ValueType> & y, const std::vector<size_type> & rows)
+{
+    std::valarray<_ValueType> result(rows.size());
+
+    for (size_type ridx{0}; ridx < rows.size(); ++ridx)
+    {
+        result[ridx] = y[rows[ridx]];
+    }
+
+    return result;
+}
+
+/*
+ * Walk the C grid over a single train/validation split and return
+ * the validation MSE for each grid point.
+ *
+ * The first point is fitted from zeros with max_iter line searches,
+ * every subsequent one is warm-started from the previous theta and
+ * given warm_iter line searches, which is enough when the grid is dense.
+ */
+template<typename _ValueType>
+std::valarray<_ValueType>
+ridge_path(
+    const array2d<_ValueType> & X_train,
+    const std::valarray<_ValueType> & y_train,
+    const array2d<_ValueType> & X_valid,
+    const std::valarray<_ValueType> & y_valid,
+    const std::valarray<_ValueType> & Cs,
+    const size_type max_iter,
+    const size_type warm_iter
+)
+{
+    typedef _ValueType value_type;
+    typedef std::valarray<value_type> vector_type;
+    typedef LinearRegression<value_type> regressor_type;
+
+    vector_type mse(Cs.size());
+    vector_type theta(0.0, X_train.shape().second);
+
+    for (size_type cidx{0}; cidx < Cs.size(); ++cidx)
+    {
+        const regressor_type regressor(
+            typename regressor_type::array_type{X_train},
+            typename regressor_type::vector_type{y_train},
+            typename regressor_type::vector_type{theta},
+            Cs[cidx],
+            cidx == 0 ? max_iter : warm_iter
+        );
+
+        theta = regressor.fit();
+
+        const vector_type residual = regressor.predict(X_valid, theta) - y_valid;
+
+        mse[cidx] = (residual * residual).sum() / residual.size();
+    }
+
+    return mse;
+}
+
+/*
+ * Same as above, but the whole grid is fitted at once as a batch
+ * (see LinearRegression::fit_batch) and scored with a single
+ * batched predict. Used with the solvers that need no warm start.
+ */
+template<typename _ValueType>
+std::valarray<_ValueType>
+ridge_path_batch(
+    const array2d<_ValueType> & X_train,
+    const std::valarray<_ValueType> & y_train,
+    const array2d<_ValueType> & X_valid,
+    const std::valarray<_ValueType> & y_valid,
+    const std::valarray<_ValueType> & Cs,
+    const size_type max_iter,
+    const Solver solver
+)
+{
+    typedef _ValueType value_type;
+    typedef std::valarray<value_type> vector_type;
+    typedef LinearRegression<value_type> regressor_type;
+    typedef typename regressor_type::array_type array_type;
+
+    const regressor_type regressor(
+        array_type{X_train},
+        vector_type{y_train},
+        vector_type{},
+        Cs[0],
+        max_iter,
+        solver
+    );
+
+    const array_type Theta = regressor.fit_batch(
+        zeros<value_type>({X_train.shape().second, Cs.size()}), Cs);
+    const array_type H = regressor.predict_batch(X_valid, Theta);
+
+    vector_type mse(Cs.size());
+
+    for (size_type cidx{0}; cidx < Cs.size(); ++cidx)
+    {
+        const vector_type residual = vector_type(H[H.column(cidx)]) - y_valid;
+
+        mse[cidx] = (residual * residual).sum() / residual.size();
+    }
+
+    return mse;
+}
+
+/*
+ * k-fold cross-validated regularization path over NROWS rows, which are
+ * subjects, so the folds are grouped by subject already.
+ *
+ * The design of every fold is made by make_fold(train_rows, valid_rows),
+ * returning a FoldData, so that whatever the design fits on the data
+ * (target encoding, scaling, ...) is fitted on the fold's training rows
+ * only and the validation rows are scored as unseen data. The designs are
+ * expected to carry the intercept column.
+ * Folds are evaluated concurrently on the pool, one task per fold.
+ *
+ * With Solver::FMinCG the grid is walked with warm starts (ridge_path),
+ * with any other solver it is fitted as one batch (ridge_path_batch).
+ */
+template<typename _ValueType, typename _MakeFold>
+RegPath<_ValueType>
+ridge_cv_path(
+    const size_type NROWS,
+    const _MakeFold & make_fold,
+    std::valarray<_ValueType> Cs,
+    const size_type nfolds,
+    const size_type max_iter,
+    const size_type warm_iter,
+    const unsigned int seed,
+    ThreadPool & pool,
+    const Solver solver = Solver::FMinCG
+)
+{
+    typedef _ValueType value_type;
+    typedef std::valarray<value_type> vector_type;
+
+    assert(nfolds > 1 && nfolds <= NROWS);
+    assert(Cs.size() > 0);
+
+    // warm starts only make sense when neighbouring points are fitted in order
+    std::sort(std::begin(Cs), std::end(Cs));
+
+    std::vector<size_type> order(NROWS);
+    std::iota(order.begin(), order.end(), 0);
+    std::mt19937 g(seed);
+    std::shuffle(order.begin(), order.end(), g);
+
+    std::vector<vector_type> fold_mse(nfolds);
+
+    pool.parallel_for(nfolds,
+        [&](const size_type fold)
+        {
+            std::vector<size_type> train_rows;
+            std::vector<size_type> valid_rows;
+
+            for (size_type idx{0}; idx < NROWS; ++idx)
+            {
+                (idx % nfolds == fold ? valid_rows : train_rows).push_back(order[idx]);
+            }
+
+            const FoldData<value_type> data = make_fold(train_rows, valid_rows);
+
+            assert(data.y_train.size() == data.X_train.shape().first);
+            assert(data.y_valid.size() == data.X_valid.shape().first);
+
+            if (solver == Solver::FMinCG)
+            {
+                fold_mse[fold] = ridge_path(
+                    data.X_train, data.y_train, data.X_valid, data.y_valid,
+                    Cs, max_iter, warm_iter);
+            }
+            else
+            {
+                fold_mse[fold] = ridge_path_batch(
+                    data.X_train, data.y_train, data.X_valid, data.y_valid,
+                    Cs, max_iter, solver);
+            }
+        }
+    );
+
+    RegPath<value_type> result;
+
+    result.C = Cs;
+    result.cv_mse = vector_type(0.0, Cs.size());
+    result.cv_std = vector_type(0.0, Cs.size());
+
+    for (const auto & mse : fold_mse)
+    {
+        result.cv_mse += mse;
+    }
+    result.cv_mse /= nfolds;
+
+    for (const auto & mse : fold_mse)
+    {
+        result.cv_std += (mse - result.cv_mse) * (mse - result.cv_mse);
+    }
+    result.cv_std = std::sqrt(result.cv_std / value_type(nfolds - 1));
+
+    const value_type * best = std::min_element(std::begin(result.cv_mse), std::end(result.cv_mse));
+    result.best_C = result.C[best - std::begin(result.cv_mse)];
+
+    return result;
+}
+
+/*
+ * The same on the rows of a fixed design X, which is expected to carry
+ * the intercept column and be standardized in the same way as it would
+ * be for the final fit. Only valid if nothing in X was fitted on y.
+ */
+template<typename _ValueType>
+RegPath<_ValueType>
+ridge_cv_path(
+    const array2d<_ValueType> & X,
+    const std::valarray<_ValueType> & y,
+    std::valarray<_ValueType> Cs,
+    const size_type nfolds,
+    const size_type max_iter,
+    const size_type warm_iter,
+    const unsigned int seed,
+    ThreadPool & pool,
+    const Solver solver = Solver::FMinCG
+)
+{
+    assert(y.size() == X.shape().first);
+
+    return ridge_cv_path(
+        X.shape().first,
+        [&X, &y](const std::vector<size_type> & train_rows, const std::vector<size_type> & valid_rows)
+        {
+            return FoldData<_ValueType>{
+                take_rows(X, train_rows), take_rows(y, train_rows),
+                take_rows(X, valid_rows), take_rows(y, valid_rows)};
+        },
+        std::move(Cs), nfolds, max_iter, warm_iter, seed, pool, solver);
+}
+
+} // namespace num
+
+#endif /* REGPATH_HPP_ */
@@ -0,0 +1,384 @@
+/*******************************************************************************
+ * Copyright (c) 2015 Wojciech Migda
+ * All rights reserved
+ * Distributed under the terms of the GNU LGPL v3
+ *******************************************************************************
+ *
+ * Filename: ridgecg.hpp
+ *
+ * Description:
+ *      Linear conjugate gradient for the ridge regression normal equations
+ *
+ * Authors:
+ *          Wojciech Migda (wm)
+ *
+ *******************************************************************************
+ * History:
+ * --------
+ * Date         Who  Ticket     Description
+ * ----------   ---  ---------  ------------------------------------------------
+ * 2026-10-19   wm              Initial version
+ * 2026-10-19   wm              ridge_cg generic over the design matrix type
+ *
+ ******************************************************************************/
+
+#ifndef RIDGECG_HPP_
+#define RIDGECG_HPP_
+
+#include "array2d.hpp"
+#include "blas.hpp"
+#include "num.hpp"
+
+#include <valarray>
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <cmath>
+#include <cassert>
+
+namespace num
+{
+
+/*
+ * Solves (X' * X + D / C) * theta = b, where D = diag(0, 1, ..., 1)
+ * leaves the intercept unregularized.
+ *
+ * Since the objective is quadratic the optimal step length along a search
+ * direction has a closed form, so every iteration costs exactly one X
+ * and one X' product, with no line search.
+ *
+ * With precondition set the system is solved with the Jacobi (diagonal)
+ * preconditioner, diag(X' * X) + D / C.
+ *
+ * Iterates until the residual norm drops below tol * |b|, or for
+ * max_iter iterations.
+ *
+ * X is only touched through gemv and sq_column_norms, so any design
+ * type providing those (InteractionDesign) can stand in for array2d.
+ */
+template<typename _ValueType, typename _DesignType = array2d<_ValueType>>
+std::valarray<_ValueType>
+ridge_cg_solve(
+    const _DesignType & X,
+    const std::valarray<_ValueType> & b,
+    std::valarray<_ValueType> theta,
+    const _ValueType C,
+    const size_type max_iter,
+    const bool precondition = false,
+    const _ValueType tol = 1e-10
+)
+{
+    typedef _ValueType value_type;
+    typedef std::valarray<value_type> vector_type;
+    typedef array2d<value_type> array_type;
+
+    const shape_type X_shape = X.shape();
+
+    assert(b.size() == X_shape.second);
+    assert(theta.size() == X_shape.second);
+
+    // regularization mask, intercept is not penalized
+    vector_type D(1.0 / C, X_shape.second);
+    D[0] = 0.0;
+
+    vector_type Xp(X_shape.first);
+    vector_type XtXp(X_shape.second);
+
+    // A * v = X' * (X * v) + D .* v
+    auto A_mul = [&X, &D, &Xp, &XtXp](const vector_type & v, vector_type & out)
+    {
+        gemv(array_type::Axis::Row, X, v, Xp);
+        gemv(array_type::Axis::Column, X, Xp, XtXp);
+        out = XtXp + D * v;
+    };
+
+    vector_type M_inv(1.0, X_shape.second);
+    if (precondition)
+    {
+        M_inv /= sq_column_norms(X) + D;
+    }
+
+    const value_type b_norm = std::sqrt((b * b).sum());
+
+    vector_type r(X_shape.second);
+    A_mul(theta, r);
+    r = b - r;
+
+    vector_type z = M_inv * r;
+    vector_type p = z;
+    vector_type q(X_shape.second);
+    value_type rz = (r * z).sum();
+
+    for (size_type iter{0}; iter < max_iter; ++iter)
+    {
+        if (std::sqrt((r * r).sum()) <= tol * b_norm)
+        {
+            break;
+        }
+
+        A_mul(p, q);
+
+        const value_type alpha = rz / (p * q).sum();
+
+        theta += alpha * p;
+        r -= alpha * q;
+
+        z = M_inv * r;
+        const value_type rz_next = (r * z).sum();
+
+        p = z + (rz_next / rz) * p;
+        rz = rz_next;
+    }
+
+    return theta;
+}
+
+/*
+ * Solves (X' * X + D / C) * theta = X' * y, the stationary point of
+ * the cost in linreg_cost_grad, so both solvers minimize the same function.
+ */
+template<typename _ValueType, typename _DesignType = array2d<_ValueType>>
+std::valarray<_ValueType>
+ridge_cg(
+    const _DesignType & X,
+    const std::valarray<_ValueType> & y,
+    std::valarray<_ValueType> theta,
+    const _ValueType C,
+    const size_type max_iter,
+    const bool precondition = false,
+    const _ValueType tol = 1e-10
+)
+{
+    typedef _ValueType value_type;
+    typedef std::valarray<value_type> vector_type;
+    typedef array2d<value_type> array_type;
+
+    assert(y.size() == X.shape().first);
+
+    vector_type b(X.shape().second);
+    gemv(array_type::Axis::Column, X, y, b);
+
+    return ridge_cg_solve(X, b, std::move(theta), C, max_iter, precondition, tol);
+}
+
+/*
+ * Mixed precision variant of ridge_cg with iterative refinement.
+ *
+ * X is converted once to _LowType, where the CG iterations (and so all
+ * the heavy X and X' products) run. The outer loop computes the residual
+ * of the normal equations in _ValueType precision, solves for a correction
+ * in _LowType and applies it in _ValueType, recovering _ValueType accuracy
+ * of theta in a few refinement steps.
+ */
+template<typename _ValueType, typename _LowType = double>
+std::valarray<_ValueType>
+ridge_mixed(
+    const array2d<_ValueType> & X,
+    const std::valarray<_ValueType> & y,
+    std::valarray<_ValueType> theta,
+    const _ValueType C,
+    const size_type max_iter,
+    const size_type refine_iter = 8,
+    const _ValueType tol = 1e-16
+)
+{
+    typedef _ValueType value_type;
+    typedef std::valarray<value_type> vector_type;
+    typedef array2d<value_type> array_type;
+
+    typedef _LowType low_type;
+    typedef std::valarray<low_type> low_vector_type;
+    typedef array2d<low_type> low_array_type;
+
+    const shape_type X_shape = X.shape();
+
+    assert(y.size() == X_shape.first);
+    assert(theta.size() == X_shape.second);
+
+    low_array_type X_low(X_shape, 0.0);
+    std::copy(X.data(), X.data() + X_shape.first * X_shape.second, X_low.data());
+
+    vector_type D(1.0 / C, X_shape.second);
+    D[0] = 0.0;
+
+    vector_type b(X_shape.second);
+    gemv(array_type::Axis::Column, X, y, b);
+    const value_type b_norm = std::sqrt((b * b).sum());
+
+    vector_type Xt(X_shape.first);
+    vector_type r(X_shape.second);
+
+    for (size_type step{0}; step < refine_iter; ++step)
+    {
+        // r = b - A * theta, in full precision
+        gemv(array_type::Axis::Row, X, theta, Xt);
+        gemv(array_type::Axis::Column, X, Xt, r);
+        r = b - r - D * theta;
+
+        if (std::sqrt((r * r).sum()) <= tol * b_norm)
+        {
+            break;
+        }
+
+        low_vector_type r_low(X_shape.second);
+        std::copy(std::begin(r), std::end(r), std::begin(r_low));
+
+        const low_vector_type d = ridge_cg_solve<low_type>(
+            X_low, r_low, low_vector_type(0.0, X_shape.second), C, max_iter, false, 1e-10);
+
+        for (size_type c{0}; c < X_shape.second; ++c)
+        {
+            theta[c] += d[c];
+        }
+    }
+
+    return theta;
+}
+
+/*
+ * Block of independent ridge_cg solves sharing X and y, one per column
+ * of Theta and entry of C. Products with X are done for all columns
+ * at once, as matrix-matrix products; every column keeps its own step
+ * lengths and leaves the block once converged.
+ */
+template<typename _ValueType>
+array2d<_ValueType>
+ridge_cg_batch(
+    const array2d<_ValueType> & X,
+    const std::valarray<_ValueType> & y,
+    array2d<_ValueType> Theta,
+    const std::valarray<_ValueType> & C,
+    const size_type max_iter,
+    const bool precondition = false,
+    const _ValueType tol = 1e-10
+)
+{
+    typedef _ValueType value_type;
+    typedef std::valarray<value_type> vector_type;
+    typedef array2d<value_type> array_type;
+
+    const size_type M{X.shape().first};
+    const size_type N{X.shape().second};
+    const size_type K{Theta.shape().second};
+
+    assert(Theta.shape().first == N);
+    assert(C.size() == K);
+
+    array_type M_inv = ones<value_type>({N, K});
+    if (precondition)
+    {
+        for (size_type n{0}; n < N; ++n)
+        {
+            const vector_type col = X[X.column(n)];
+            const value_type diag = (col * col).sum();
+
+            for (size_type k{0}; k < K; ++k)
+            {
+                M_inv.at(n, k) = 1.0 / (diag + (n == 0 ? 0.0 : 1.0 / C[k]));
+            }
+        }
+    }
+
+    vector_type b(0.0, N);
+    X.mul(array_type::Axis::Column, y, b);
+    const value_type b_norm = std::sqrt((b * b).sum());
+
+    array_type R = zeros<value_type>({N, K});
+    array_type XP = zeros<value_type>({M, K});
+    array_type Q = zeros<value_type>({N, K});
+
+    // R = b - (X' * X * Theta + D .* Theta / C)
+    X.mul(array_type::Axis::Row, Theta, XP);
+    X.mul(array_type::Axis::Column, XP, Q);
+    for (size_type n{0}; n < N; ++n)
+    {
+        for (size_type k{0}; k < K; ++k)
+        {
+            R.at(n, k) = b[n] - Q.at(n, k) - (n == 0 ? 0.0 : Theta.at(n, k) / C[k]);
+        }
+    }
+
+    array_type Z = R;
+    Z[Z.columns(0, -1)] = vector_type(R[R.columns(0, -1)]) * vector_type(M_inv[M_inv.columns(0, -1)]);
+    array_type P = Z;
+
+    vector_type rz(K);
+    for (size_type k{0}; k < K; ++k)
+    {
+        rz[k] = (vector_type(R[R.column(k)]) * vector_type(Z[Z.column(k)])).sum();
+    }
+
+    std::valarray<bool> active(true, K);
+
+    for (size_type iter{0}; iter < max_iter; ++iter)
+    {
+        std::vector<size_type> cols;
+        for (size_type k{0}; k < K; ++k)
+        {
+            const vector_type r = R[R.column(k)];
+
+            active[k] = active[k] && (std::sqrt((r * r).sum()) > tol * b_norm);
+            if (active[k])
+            {
+                cols.push_back(k);
+            }
+        }
+        if (cols.empty())
+        {
+            break;
+        }
+
+        // converged columns drop out of the products
+        const size_type KA{cols.size()};
+        array_type PA = zeros<value_type>({N, KA});
+        for (size_type n{0}; n < N; ++n)
+        {
+            for (size_type a{0}; a < KA; ++a)
+            {
+                PA.at(n, a) = P.at(n, cols[a]);
+            }
+        }
+
+        // Q = X' * (X * P) + D .* P / C
+        XP = zeros<value_type>({M, KA});
+        Q = zeros<value_type>({N, KA});
+        X.mul(array_type::Axis::Row, PA, XP);
+        X.mul(array_type::Axis::Column, XP, Q);
+
+        for (size_type a{0}; a < KA; ++a)
+        {
+            const size_type k{cols[a]};
+
+            value_type pq{0};
+            for (size_type n{0}; n < N; ++n)
+            {
+                Q.at(n, a) += (n == 0 ? 0.0 : P.at(n, k) / C[k]);
+                pq += P.at(n, k) * Q.at(n, a);
+            }
+
+            const value_type alpha = rz[k] / pq;
+
+            value_type rz_next{0};
+            for (size_type n{0}; n < N; ++n)
+            {
+                Theta.at(n, k) += alpha * P.at(n, k);
+                R.at(n, k) -= alpha * Q.at(n, a);
+                Z.at(n, k) = M_inv.at(n, k) * R.at(n, k);
+                rz_next += R.at(n, k) * Z.at(n, k);
+            }
+
+            const value_type beta = rz_next / rz[k];
+            for (size_type n{0}; n < N; ++n)
+            {
+                P.at(n, k) = Z.at(n, k) + beta * P.at(n, k);
+            }
+            rz[k] = rz_next;
+        }
+    }
+
+    return Theta;
+}
+
+} // namespace num
+
+#endif /* RIDGECG_HPP_ */
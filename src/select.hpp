@@ -0,0 +1,369 @@
+/*******************************************************************************
+ * Copyright (c) 2015 Wojciech Migda
+ * All rights reserved
+ * Distributed under the terms of the GNU LGPL v3
+ *******************************************************************************
+ *
+ * Filename: select.hpp
+ *
+ * Description:
+ *      Greedy forward selection of pairwise interactions
+ *
+ * Authors:
+ *          Wojciech Migda (wm)
+ *
+ *******************************************************************************
+ * History:
+ * --------
+ * Date         Who  Ticket     Description
+ * ----------   ---  ---------  ------------------------------------------------
+ * 2026-10-19   wm              Initial version
+ *
+ ******************************************************************************/
+
+#ifndef SELECT_HPP_
+#define SELECT_HPP_
+
+#include "array2d.hpp"
+#include "blas.hpp"
+#include "thread_pool.hpp"
+#include "num.hpp"
+
+#include <valarray>
+#include <vector>
+#include <utility>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+#include <cassert>
+
+namespace num
+{
+
+/**
+ *******************************************************************************
+ *   @brief Ridge regression grown one design column at a time
+ *******************************************************************************
+ *   @history @code
+ *   DATE         VERSION    WHO     DESCRIPTION
+ *   -----------  -------    ------  -----------
+ *   2026-10-19              wm      Class created.
+ *   @endcode
+ *******************************************************************************
+ *   Keeps the Cholesky factor L of X' * X + D / C, and w = L^-1 * X' * y,
+ *   for the columns appended so far. A new column z only borders L
+ *   with one row,
+ *
+ *       l = L^-1 * X' * z,   d = sqrt(z' * z + 1 / C - l' * l),
+ *
+ *   so @c probe finds the fit with z appended, and its validation
+ *   error, in O(M * K + K^2) rather than refitting from scratch.
+ *   Probing does not change the model, so any number of probes may run
+ *   concurrently; @c append commits one of them.
+ *******************************************************************************
+ */
+template<typename _ValueType>
+class IncrementalRidge
+{
+public:
+    typedef _ValueType value_type;
+    typedef std::valarray<value_type> vector_type;
+
+    struct Step
+    {
+        // new row of L, without its diagonal d
+        vector_type l;
+        value_type d;
+        // new entry of w
+        value_type w;
+        // validation MSE with the column appended, infinity if it is
+        // (numerically) dependent on those already in
+        value_type valid_mse;
+    };
+
+    IncrementalRidge(vector_type && y_train, vector_type && y_valid, value_type C);
+
+    /*
+     * z_train and z_valid are the training and validation rows of the new
+     * column, regularize is false for the intercept only
+     */
+    Step probe(const vector_type & z_train, const vector_type & z_valid, bool regularize = true) const;
+
+    void append(vector_type && z_train, vector_type && z_valid, Step && step);
+
+    size_type size(void) const;
+
+    // validation MSE of the current model
+    value_type valid_mse(void) const;
+
+private:
+    const vector_type m_y_train;
+    const vector_type m_y_valid;
+    const value_type m_C;
+
+    std::vector<vector_type> m_X_train;
+    std::vector<vector_type> m_X_valid;
+    // rows of L, row k holds k + 1 entries
+    std::vector<vector_type> m_L;
+    std::vector<value_type> m_w;
+    value_type m_valid_mse;
+};
+
+template<typename _ValueType>
+IncrementalRidge<_ValueType>::IncrementalRidge(vector_type && y_train, vector_type && y_valid, value_type C)
+:
+    m_y_train(std::move(y_train)),
+    m_y_valid(std::move(y_valid)),
+    m_C{C},
+    m_X_train{},
+    m_X_valid{},
+    m_L{},
+    m_w{},
+    m_valid_mse{num::mean<value_type>(m_y_valid * m_y_valid)}
+{
+}
+
+template<typename _ValueType>
+typename IncrementalRidge<_ValueType>::Step
+IncrementalRidge<_ValueType>::probe(
+    const vector_type & z_train,
+    const vector_type & z_valid,
+    bool regularize) const
+{
+    assert(z_train.size() == m_y_train.size());
+    assert(z_valid.size() == m_y_valid.size());
+
+    const size_type K{m_L.size()};
+    const size_type M{m_y_train.size()};
+
+    Step step{vector_type(K), 0, 0, std::numeric_limits<value_type>::infinity()};
+
+    // L * l = X' * z
+    for (size_type k{0}; k < K; ++k)
+    {
+        value_type sum = dot(&m_X_train[k][0], &z_train[0], M);
+
+        for (size_type j{0}; j < k; ++j)
+        {
+            sum -= m_L[k][j] * step.l[j];
+        }
+        step.l[k] = sum / m_L[k][k];
+    }
+
+    const value_type zz = dot(&z_train[0], &z_train[0], M);
+    const value_type d2 = zz + (regularize ? 1.0 / m_C : 0.0) - (step.l * step.l).sum();
+
+    if (!(d2 > zz * std::numeric_limits<value_type>::epsilon() * K))
+    {
+        return step;
+    }
+
+    step.d = std::sqrt(d2);
+
+    value_type lw{0};
+    for (size_type k{0}; k < K; ++k)
+    {
+        lw += step.l[k] * m_w[k];
+    }
+    step.w = (dot(&z_train[0], &m_y_train[0], M) - lw) / step.d;
+
+    // L_ext' * theta = [w; w_new], the new coefficient first
+    vector_type theta(K + 1);
+    theta[K] = step.w / step.d;
+    for (size_type k{K}; k-- > 0; /* nop */)
+    {
+        value_type sum = m_w[k] - step.l[k] * theta[K];
+
+        for (size_type j{k + 1}; j < K; ++j)
+        {
+            sum -= m_L[j][k] * theta[j];
+        }
+        theta[k] = sum / m_L[k][k];
+    }
+
+    vector_type residual = theta[K] * z_valid - m_y_valid;
+    for (size_type k{0}; k < K; ++k)
+    {
+        residual += theta[k] * m_X_valid[k];
+    }
+
+    step.valid_mse = num::mean<value_type>(residual * residual);
+
+    return step;
+}
+
+template<typename _ValueType>
+void
+IncrementalRidge<_ValueType>::append(vector_type && z_train, vector_type && z_valid, Step && step)
+{
+    assert(step.l.size() == m_L.size());
+    assert(step.d > 0);
+
+    vector_type row(m_L.size() + 1);
+    row[std::slice(0, m_L.size(), 1)] = step.l;
+    row[m_L.size()] = step.d;
+
+    m_L.push_back(std::move(row));
+    m_w.push_back(step.w);
+    m_X_train.push_back(std::move(z_train));
+    m_X_valid.push_back(std::move(z_valid));
+    m_valid_mse = step.valid_mse;
+}
+
+template<typename _ValueType>
+inline
+size_type
+IncrementalRidge<_ValueType>::size(void) const
+{
+    return m_L.size();
+}
+
+template<typename _ValueType>
+inline
+typename IncrementalRidge<_ValueType>::value_type
+IncrementalRidge<_ValueType>::valid_mse(void) const
+{
+    return m_valid_mse;
+}
+
+/**
+ *******************************************************************************
+ *   @brief Outcome of @c select_pairs
+ *******************************************************************************
+ *   @history @code
+ *   DATE         VERSION    WHO     DESCRIPTION
+ *   -----------  -------    ------  -----------
+ *   2026-10-19              wm      Class created.
+ *   @endcode
+ *******************************************************************************
+ */
+template<typename _ValueType>
+struct PairSelection
+{
+    // in the order they were selected
+    std::vector<std::pair<size_type, size_type>> pairs;
+    // validation MSE of the base model, then after each selected pair
+    std::vector<_ValueType> valid_mse;
+};
+
+/*
+ * Greedy forward selection of pairwise products of the columns of B.
+ *
+ * The model starts as the ridge regression on the intercept and the
+ * columns of B, every column scaled by its training deviation the way
+ * standardize_X_data does it. Each step probes all remaining candidates
+ * concurrently on the pool and appends the one with the lowest validation
+ * MSE, until max_pairs are in or the best one improves the validation
+ * MSE by less than a fraction min_gain. Ties go to the earlier candidate,
+ * so the outcome does not depend on the pool's concurrency.
+ */
+template<typename _ValueType>
+PairSelection<_ValueType>
+select_pairs(
+    const array2d<_ValueType> & B_train,
+    const std::valarray<_ValueType> & y_train,
+    const array2d<_ValueType> & B_valid,
+    const std::valarray<_ValueType> & y_valid,
+    const std::valarray<std::pair<size_type, size_type>> & candidates,
+    const _ValueType C,
+    const size_type max_pairs,
+    ThreadPool & pool,
+    const _ValueType min_gain = 0
+)
+{
+    typedef _ValueType value_type;
+    typedef std::valarray<value_type> vector_type;
+    typedef IncrementalRidge<value_type> model_type;
+
+    const size_type N{B_train.shape().second};
+
+    assert(B_valid.shape().second == N);
+    assert(y_train.size() == B_train.shape().first);
+    assert(y_valid.size() == B_valid.shape().first);
+
+    // z = B[:, i] * B[:, j] on both sides, scaled by the training deviation
+    auto product = [&B_train, &B_valid](const std::pair<size_type, size_type> & pair)
+    {
+        vector_type z_train = (vector_type)B_train[B_train.column(pair.first)] *
+            (vector_type)B_train[B_train.column(pair.second)];
+        vector_type z_valid = (vector_type)B_valid[B_valid.column(pair.first)] *
+            (vector_type)B_valid[B_valid.column(pair.second)];
+        const value_type dev = num::std<value_type>(z_train);
+
+        return std::make_pair(vector_type(z_train / dev), vector_type(z_valid / dev));
+    };
+
+    model_type model(vector_type{y_train}, vector_type{y_valid}, C);
+
+    {
+        const vector_type one_train(1.0, y_train.size());
+        const vector_type one_valid(1.0, y_valid.size());
+
+        typename model_type::Step step = model.probe(one_train, one_valid, false);
+        model.append(vector_type{one_train}, vector_type{one_valid}, std::move(step));
+    }
+    for (size_type c{0}; c < N; ++c)
+    {
+        const vector_type col_train = B_train[B_train.column(c)];
+        const vector_type col_valid = B_valid[B_valid.column(c)];
+        const value_type dev = num::std<value_type>(col_train);
+
+        vector_type z_train = col_train / dev;
+        vector_type z_valid = col_valid / dev;
+        typename model_type::Step step = model.probe(z_train, z_valid);
+
+        // constant or dependent base columns stay out
+        if (std::isfinite(step.valid_mse))
+        {
+            model.append(std::move(z_train), std::move(z_valid), std::move(step));
+        }
+    }
+
+    PairSelection<value_type> result;
+    result.valid_mse.push_back(model.valid_mse());
+
+    std::vector<bool> taken(candidates.size(), false);
+
+    while (result.pairs.size() < std::min(max_pairs, candidates.size()))
+    {
+        std::vector<value_type> score(candidates.size(), std::numeric_limits<value_type>::infinity());
+
+        pool.parallel_for(candidates.size(),
+            [&](const size_type cidx)
+            {
+                if (!taken[cidx])
+                {
+                    const auto z = product(candidates[cidx]);
+
+                    score[cidx] = model.probe(z.first, z.second).valid_mse;
+                }
+            }
+        );
+
+        size_type best{0};
+        for (size_type cidx{1}; cidx < candidates.size(); ++cidx)
+        {
+            best = score[cidx] < score[best] ? cidx : best;
+        }
+
+        if (!(score[best] < model.valid_mse() * (1 - min_gain)))
+        {
+            break;
+        }
+
+        auto z = product(candidates[best]);
+        typename model_type::Step step = model.probe(z.first, z.second);
+
+        model.append(std::move(z.first), std::move(z.second), std::move(step));
+
+        taken[best] = true;
+        result.pairs.push_back(candidates[best]);
+        result.valid_mse.push_back(model.valid_mse());
+    }
+
+    return result;
+}
+
+} // namespace num
+
+#endif /* SELECT_HPP_ */
@@ -0,0 +1,293 @@
+/*******************************************************************************
+ * Copyright (c) 2015 Wojciech Migda
+ * All rights reserved
+ * Distributed under the terms of the GNU LGPL v3
+ *******************************************************************************
+ *
+ * Filename: task_graph.hpp
+ *
+ * Description:
+ *      Graph of dependent tasks executed on a ThreadPool
+ *
+ * Authors:
+ *          Wojciech Migda (wm)
+ *
+ *******************************************************************************
+ * History:
+ * --------
+ * Date         Who  Ticket     Description
+ * ----------   ---  ---------  ------------------------------------------------
+ * 2026-10-19   wm              Initial version
+ * 2026-10-19   wm              Dependents of a failed task are skipped
+ * 2026-10-19   wm              Caller sleeps while queued tasks are taken elsewhere
+ *
+ ******************************************************************************/
+
+#ifndef TASK_GRAPH_HPP_
+#define TASK_GRAPH_HPP_
+
+#include "thread_pool.hpp"
+#include "num.hpp"
+
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <exception>
+#include <limits>
+#include <cassert>
+
+namespace num
+{
+
+/**
+ *******************************************************************************
+ *   @brief Tasks with dependencies, run on a ThreadPool
+ *******************************************************************************
+ *   @history @code
+ *   DATE         VERSION    WHO     DESCRIPTION
+ *   -----------  -------    ------  -----------
+ *   2026-10-19              wm      Class created.
+ *   @endcode
+ *******************************************************************************
+ *   A task becomes ready once all the tasks it was added after are done.
+ *   The thread which completes a task goes on with one of the tasks this
+ *   made ready and queues the others on the pool, where idle workers
+ *   steal them. The thread calling @c run executes queued pool work
+ *   while it waits, so graphs may be run from inside pool tasks, and on
+ *   a pool of concurrency 1 they run sequentially, in a topological order.
+ *
+ *   Tasks are free to use the pool themselves, e.g. with parallel_for.
+ *   When a task throws, everything depending on it is skipped rather
+ *   than run on missing inputs; skipped tasks still count as done.
+ *******************************************************************************
+ */
+class TaskGraph
+{
+public:
+    typedef size_type task_id;
+
+    /*
+     * New task running fn, after all the tasks of after
+     */
+    task_id add(std::function<void()> fn, const std::vector<task_id> & after = {});
+
+    size_type size(void) const;
+
+    /*
+     * Runs all tasks, returns when they are done. An exception thrown
+     * by a task is rethrown here; the tasks depending on it, directly
+     * or not, are skipped, as their inputs are missing.
+     */
+    void run(ThreadPool & pool) const;
+
+private:
+    struct Node
+    {
+        std::function<void()> fn;
+        std::vector<task_id> successors;
+        size_type npredecessors;
+    };
+
+    std::vector<Node> m_nodes;
+};
+
+inline
+TaskGraph::task_id
+TaskGraph::add(std::function<void()> fn, const std::vector<task_id> & after)
+{
+    const task_id id{m_nodes.size()};
+
+    m_nodes.push_back(Node{std::move(fn), {}, after.size()});
+
+    for (const auto pred : after)
+    {
+        assert(pred < id);
+        m_nodes[pred].successors.push_back(id);
+    }
+
+    return id;
+}
+
+inline
+size_type
+TaskGraph::size(void) const
+{
+    return m_nodes.size();
+}
+
+inline
+void
+TaskGraph::run(ThreadPool & pool) const
+{
+    constexpr task_id NONE{std::numeric_limits<task_id>::max()};
+
+    // shared with queued tasks, which may still notify after we have returned
+    struct State
+    {
+        State(const std::vector<Node> & nodes, ThreadPool & pool)
+        :
+            nodes(nodes),
+            pool(pool),
+            waiting(new std::atomic<size_type>[nodes.size()]),
+            skipped(new std::atomic<bool>[nodes.size()]),
+            done{0},
+            queued{0},
+            posted{0}
+        {
+            for (size_type idx{0}; idx < nodes.size(); ++idx)
+            {
+                waiting[idx] = nodes[idx].npredecessors;
+                skipped[idx] = false;
+            }
+        }
+
+        const std::vector<Node> & nodes;
+        ThreadPool & pool;
+        std::unique_ptr<std::atomic<size_type>[]> waiting;
+        // after a failed task, set before its successor can become ready
+        std::unique_ptr<std::atomic<bool>[]> skipped;
+        std::atomic<size_type> done;
+        // queued on the pool, not yet started
+        std::atomic<size_type> queued;
+        // ever queued, to tell a new task from one already waited for
+        std::atomic<size_type> posted;
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::exception_ptr error;
+    };
+
+    const size_type NNODES{m_nodes.size()};
+
+    if (NNODES == 0)
+    {
+        return;
+    }
+
+    auto state = std::make_shared<State>(m_nodes, pool);
+
+    std::function<void(const std::shared_ptr<State> &, task_id)> execute;
+    std::function<void(const std::shared_ptr<State> &, task_id)> post;
+
+    // the queued closures hold copies of execute, which holds one of post
+    post = [&execute](const std::shared_ptr<State> & state, task_id id)
+    {
+        ++state->queued;
+        state->pool.enqueue([state, id, execute]()
+            {
+                --state->queued;
+                execute(state, id);
+            }
+        );
+        ++state->posted;
+
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->cv.notify_all();
+    };
+
+    execute = [post, NONE, NNODES](const std::shared_ptr<State> & state, task_id id)
+    {
+        while (id != NONE)
+        {
+            const Node & node = state->nodes[id];
+            bool failed{state->skipped[id]};
+
+            if (!failed)
+            {
+                try
+                {
+                    node.fn();
+                }
+                catch (...)
+                {
+                    failed = true;
+
+                    std::lock_guard<std::mutex> lock(state->mutex);
+                    state->error = std::current_exception();
+                }
+            }
+
+            id = NONE;
+            for (const auto succ : node.successors)
+            {
+                if (failed)
+                {
+                    state->skipped[succ] = true;
+                }
+                if (--state->waiting[succ] == 0)
+                {
+                    if (id == NONE)
+                    {
+                        id = succ;
+                    }
+                    else
+                    {
+                        post(state, succ);
+                    }
+                }
+            }
+
+            ++state->done;
+
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->cv.notify_all();
+        }
+    };
+
+    std::vector<task_id> roots;
+    for (task_id id{0}; id < NNODES; ++id)
+    {
+        if (m_nodes[id].npredecessors == 0)
+        {
+            roots.push_back(id);
+        }
+    }
+    assert(!roots.empty());
+
+    for (size_type idx{1}; idx < roots.size(); ++idx)
+    {
+        post(state, roots[idx]);
+    }
+    execute(state, roots.front());
+
+    // a task still counted as queued may have been taken by another
+    // thread already, then we wait for something to change instead
+    bool idle{false};
+    size_type seen_done{0};
+    size_type seen_posted{0};
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(state->mutex);
+            state->cv.wait(lock, [&]
+                {
+                    return state->done == NNODES || (idle ?
+                        state->done != seen_done || state->posted != seen_posted :
+                        state->queued != 0);
+                }
+            );
+
+            if (state->done == NNODES)
+            {
+                break;
+            }
+
+            seen_done = state->done;
+            seen_posted = state->posted;
+        }
+
+        idle = !pool.run_pending();
+    }
+
+    if (state->error)
+    {
+        std::rethrow_exception(state->error);
+    }
+}
+
+} // namespace num
+
+#endif /* TASK_GRAPH_HPP_ */
@@ -0,0 +1,454 @@
+/*******************************************************************************
+ * Copyright (c) 2015 Wojciech Migda
+ * All rights reserved
+ * Distributed under the terms of the GNU LGPL v3
+ *******************************************************************************
+ *
+ * Filename: thread_pool.hpp
+ *
+ * Description:
+ *      Fixed-size thread pool with a parallel_for and a parallel sum
+ *
+ * Authors:
+ *          Wojciech Migda (wm)
+ *
+ *******************************************************************************
+ * History:
+ * --------
+ * Date         Who  Ticket     Description
+ * ----------   ---  ---------  ------------------------------------------------
+ * 2026-10-19   wm              Initial version
+ * 2026-10-19   wm              Parallel fixed-tree sum
+ * 2026-10-19   wm              Per-worker queues with work stealing
+ *
+ ******************************************************************************/
+
+#ifndef THREAD_POOL_HPP_
+#define THREAD_POOL_HPP_
+
+#include "num.hpp"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <future>
+#include <functional>
+#include <memory>
+#include <deque>
+#include <vector>
+#include <algorithm>
+#include <utility>
+
+namespace num
+{
+
+/**
+ *******************************************************************************
+ *   @brief Fixed-size pool of worker threads
+ *******************************************************************************
+ *   @history @code
+ *   DATE         VERSION    WHO     DESCRIPTION
+ *   -----------  -------    ------  -----------
+ *   2026-10-19              wm      Class created.
+ *   @endcode
+ *******************************************************************************
+ *   Concurrency of the pool counts the calling thread as well: a pool
+ *   of concurrency N runs N - 1 workers and the thread which calls
+ *   @c parallel_for executes iterations alongside them. That makes a
+ *   pool of concurrency 1 plain sequential execution, and lets
+ *   @c parallel_for be nested inside pool tasks without deadlocking:
+ *   the caller never waits for an iteration that nobody has started.
+ *
+ *   Every worker keeps its own queue. Tasks queued from a worker go to
+ *   its queue, which it serves last in first out, those queued from any
+ *   other thread to a shared one. An idle worker takes from the shared
+ *   queue, then steals the oldest task of another worker, so nested work
+ *   stays with the thread which spawned it until someone is idle.
+ *******************************************************************************
+ */
+class ThreadPool
+{
+public:
+    explicit ThreadPool(size_type concurrency = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool & operator=(const ThreadPool &) = delete;
+
+    /*
+     * Total number of threads which can run pool work,
+     * the calling thread included
+     */
+    size_type concurrency(void) const;
+
+    template<typename _Fn>
+    std::future<typename std::result_of<_Fn()>::type>
+    submit(_Fn fn);
+
+    /*
+     * Call fn(idx) for idx in [0, size), returns when all calls are done
+     */
+    void parallel_for(size_type size, const std::function<void(size_type)> & fn);
+
+    /*
+     * Run one queued task on the calling thread, if there is any,
+     * for threads which wait for pool work to help with it
+     */
+    bool run_pending(void);
+
+private:
+    friend class TaskGraph;
+
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    // pool and queue index of the worker running on the calling thread
+    static std::pair<const ThreadPool *, size_type> & current_worker(void);
+
+    // index of the calling thread's queue, 0 (the shared one) unless
+    // it is a worker of this pool
+    size_type queue_index(void) const;
+
+    void enqueue(std::function<void()> && task);
+    bool take(size_type self, std::function<void()> & task);
+    void worker_loop(size_type self);
+
+    std::vector<std::thread> m_workers;
+    // 0 is the shared queue, worker k serves k + 1
+    std::vector<std::unique_ptr<Queue>> m_queues;
+    std::atomic<size_type> m_pending;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_stop;
+};
+
+inline
+ThreadPool::ThreadPool(size_type concurrency)
+:
+    m_workers{},
+    m_queues{},
+    m_pending{0},
+    m_mutex{},
+    m_cv{},
+    m_stop{false}
+{
+    if (concurrency == 0)
+    {
+        concurrency = std::max<size_type>(1, std::thread::hardware_concurrency());
+    }
+
+    for (size_type idx{0}; idx < concurrency; ++idx)
+    {
+        m_queues.emplace_back(new Queue);
+    }
+    for (size_type idx{1}; idx < concurrency; ++idx)
+    {
+        m_workers.emplace_back(&ThreadPool::worker_loop, this, idx);
+    }
+}
+
+inline
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cv.notify_all();
+
+    for (auto & worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+inline
+size_type
+ThreadPool::concurrency(void) const
+{
+    return m_workers.size() + 1;
+}
+
+inline
+std::pair<const ThreadPool *, size_type> &
+ThreadPool::current_worker(void)
+{
+    thread_local std::pair<const ThreadPool *, size_type> worker{nullptr, 0};
+
+    return worker;
+}
+
+inline
+size_type
+ThreadPool::queue_index(void) const
+{
+    return current_worker().first == this ? current_worker().second : 0;
+}
+
+inline
+void
+ThreadPool::enqueue(std::function<void()> && task)
+{
+    Queue & queue = *m_queues[queue_index()];
+
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+    }
+    {
+        // under the lock sleeping workers check m_pending with
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_pending;
+    }
+    m_cv.notify_one();
+}
+
+inline
+bool
+ThreadPool::take(size_type self, std::function<void()> & task)
+{
+    const size_type NQUEUES{m_queues.size()};
+
+    for (size_type step{0}; step < NQUEUES; ++step)
+    {
+        // own queue first, newest task, then the shared one and
+        // the other workers' ones, oldest task
+        const size_type idx{step == 0 ? self : (self + step) % NQUEUES};
+        Queue & queue = *m_queues[idx];
+
+        std::lock_guard<std::mutex> lock(queue.mutex);
+
+        if (!queue.tasks.empty())
+        {
+            if (idx != 0 && step == 0)
+            {
+                task = std::move(queue.tasks.back());
+                queue.tasks.pop_back();
+            }
+            else
+            {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+            }
+            --m_pending;
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+inline
+bool
+ThreadPool::run_pending(void)
+{
+    std::function<void()> task;
+
+    if (take(queue_index(), task))
+    {
+        task();
+        return true;
+    }
+    else
+    {
+        return false;
+    }
+}
+
+inline
+void
+ThreadPool::worker_loop(size_type self)
+{
+    current_worker() = {this, self};
+
+    while (true)
+    {
+        std::function<void()> task;
+
+        if (take(self, task))
+        {
+            task();
+        }
+        else
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [this]{ return m_stop || m_pending != 0; });
+
+            if (m_stop && m_pending == 0)
+            {
+                return;
+            }
+        }
+    }
+}
+
+template<typename _Fn>
+std::future<typename std::result_of<_Fn()>::type>
+ThreadPool::submit(_Fn fn)
+{
+    typedef typename std::result_of<_Fn()>::type result_type;
+
+    auto task = std::make_shared<std::packaged_task<result_type()>>(std::move(fn));
+    std::future<result_type> result = task->get_future();
+
+    if (m_workers.empty())
+    {
+        (*task)();
+    }
+    else
+    {
+        enqueue([task](){ (*task)(); });
+    }
+
+    return result;
+}
+
+inline
+void
+ThreadPool::parallel_for(size_type size, const std::function<void(size_type)> & fn)
+{
+    // shared with helper tasks which may get scheduled after we have returned
+    struct State
+    {
+        State(size_type size, const std::function<void(size_type)> & fn)
+        :
+            next{0}, done{0}, size{size}, fn{fn}
+        {}
+
+        std::atomic<size_type> next;
+        std::atomic<size_type> done;
+        const size_type size;
+        const std::function<void(size_type)> fn;
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::exception_ptr error;
+    };
+
+    if (size == 0)
+    {
+        return;
+    }
+
+    auto state = std::make_shared<State>(size, fn);
+
+    auto drain = [](const std::shared_ptr<State> & state)
+    {
+        for (size_type idx = state->next++; idx < state->size; idx = state->next++)
+        {
+            try
+            {
+                state->fn(idx);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                state->error = std::current_exception();
+            }
+
+            if (++state->done == state->size)
+            {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                state->cv.notify_all();
+            }
+        }
+    };
+
+    const size_type helpers = std::min(size - 1, m_workers.size());
+    for (size_type idx{0}; idx < helpers; ++idx)
+    {
+        enqueue([state, drain](){ drain(state); });
+    }
+
+    drain(state);
+
+    {
+        // only iterations already being executed by someone are waited for
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->cv.wait(lock, [&state]{ return state->done == state->size; });
+    }
+
+    if (state->error)
+    {
+        std::rethrow_exception(state->error);
+    }
+}
+
+/*
+ * num::sum evaluated on the pool: the top levels of the summation tree
+ * are cut into subtrees, summed concurrently, and joined back in the
+ * very same shape, so the result is bit-identical to num::sum for any
+ * concurrency of the pool.
+ */
+template<typename _ValueType>
+_ValueType
+sum(ThreadPool & pool, const _ValueType * data, const size_type size)
+{
+    typedef _ValueType value_type;
+    typedef std::pair<size_type, size_type> range_type;
+
+    // enough subtrees to keep every thread busy
+    size_type depth{0};
+    while ((size_type(1) << depth) < 4 * pool.concurrency())
+    {
+        ++depth;
+    }
+
+    std::vector<range_type> subtrees;
+
+    std::function<void(size_type, size_type, size_type)> cut =
+        [&cut, &subtrees](const size_type offset, const size_type len, const size_type level)
+        {
+            if (level == 0 || len <= SUM_BLOCK)
+            {
+                subtrees.emplace_back(offset, len);
+            }
+            else
+            {
+                const size_type half{sum_split(len)};
+
+                cut(offset, half, level - 1);
+                cut(offset + half, len - half, level - 1);
+            }
+        };
+    cut(0, size, depth);
+
+    std::vector<value_type> partial(subtrees.size());
+
+    pool.parallel_for(subtrees.size(),
+        [data, &subtrees, &partial](const size_type idx)
+        {
+            partial[idx] = sum(data + subtrees[idx].first, subtrees[idx].second);
+        }
+    );
+
+    size_type next{0};
+
+    std::function<value_type(size_type, size_type)> join =
+        [&join, &partial, &next](const size_type len, const size_type level) -> value_type
+        {
+            if (level == 0 || len <= SUM_BLOCK)
+            {
+                return partial[next++];
+            }
+            else
+            {
+                const size_type half{sum_split(len)};
+
+                const value_type lhs = join(half, level - 1);
+                const value_type rhs = join(len - half, level - 1);
+
+                return lhs + rhs;
+            }
+        };
+
+    return join(size, depth);
+}
+
+} // namespace num
+
+#endif /* THREAD_POOL_HPP_ */